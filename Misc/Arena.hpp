@@ -0,0 +1,204 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ScopedPtr.hpp"
+
+/// <summary> Bump allocator, memory is given back all at once by resetting to a marker </summary>
+class Arena
+{
+public:
+	/// <summary> Position of the arena, allocations made after it are freed by Reset </summary>
+	struct Marker
+	{
+		size_t block = 0;
+		size_t offset = 0;
+	};
+
+	/// <summary> Resets the arena to its state at construction when leaving the scope </summary>
+	class Scope
+	{
+		Arena& arena;
+		const Marker marker;
+	public:
+		Scope(Arena& arena) : arena(arena), marker(arena.GetMarker())
+		{ }
+
+		Scope(const Scope&) = delete;
+		Scope& operator = (const Scope&) = delete;
+
+		~Scope()
+		{
+			arena.Reset(marker);
+		}
+	};
+protected:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> data;
+		size_t size;
+	};
+	std::vector<Block> blocks; //Blocks are kept after a reset and reused
+	size_t block = 0; //Index of the current block
+	size_t offset = 0; //First free byte of the current block
+	const size_t blockSize;
+public:
+	/// <summary> Creates an arena, no memory is allocated until the first allocation </summary>
+	/// <param name="blockSize"> Size of the blocks requested from the heap (Optional) </param>
+	Arena(const size_t blockSize = 64 * 1024) : blockSize(blockSize)
+	{ }
+
+	Arena(const Arena&) = delete;
+	Arena& operator = (const Arena&) = delete;
+
+	/// <summary> Allocates raw memory </summary>
+	/// <param name="size"> Number of bytes </param>
+	/// <param name="alignment"> Alignment of the memory, power of two (Optional) </param>
+	/// <returns> Pointer to the memory, valid until the arena is reset before it </returns>
+	void* Allocate(const size_t size, const size_t alignment = alignof(std::max_align_t))
+	{
+		while (true)
+		{
+			if (block < blocks.size())
+			{
+				const uintptr_t base = (uintptr_t)blocks[block].data.get();
+				const size_t aligned = (size_t)(((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+				if (aligned + size <= blocks[block].size)
+				{
+					offset = aligned + size;
+					return blocks[block].data.get() + aligned;
+				}
+				if (offset == 0 && blocks[block].size < size + alignment)
+				{
+					//Reused block is too small for this allocation, replace it
+					blocks[block] = { std::unique_ptr<uint8_t[]>(new uint8_t[size + alignment]), size + alignment };
+					continue;
+				}
+				block++;
+				offset = 0;
+				continue;
+			}
+			const size_t bytes = std::max(blockSize, size + alignment);
+			blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[bytes]), bytes });
+		}
+	}
+
+	/// <summary> Allocates an uninitialized array </summary>
+	/// <param name="count"> Number of elements </param>
+	/// <returns> Pointer to the first element </returns>
+	template <typename T>
+	inline T* Allocate(const size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "[class Arena] Arrays are never destructed, use New for other types");
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	/// <summary> Constructs an object in the arena, it has to be destructed by the caller (see ArenaPtr) </summary>
+	template <typename T, typename... Args>
+	inline T* New(Args&&... args)
+	{
+		return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	/// <summary> Gives back the memory if it was the last allocation, otherwise it's kept until the next reset </summary>
+	/// <param name="ptr"> Pointer returned by Allocate </param>
+	/// <param name="size"> Size given to Allocate </param>
+	void Free(void* ptr, const size_t size) noexcept
+	{
+		if (block < blocks.size() && static_cast<uint8_t*>(ptr) + size == blocks[block].data.get() + offset)
+			offset = static_cast<uint8_t*>(ptr) - blocks[block].data.get();
+	}
+
+	/// <summary> Returns the current position of the arena </summary>
+	inline const Marker GetMarker() const noexcept
+	{
+		Marker marker;
+		marker.block = block;
+		marker.offset = offset;
+		return marker;
+	}
+
+	/// <summary> Frees every allocation made after the marker </summary>
+	inline void Reset(const Marker& marker) noexcept
+	{
+		block = marker.block;
+		offset = marker.offset;
+	}
+
+	/// <summary> Frees every allocation, the blocks are kept for reuse </summary>
+	inline void Reset() noexcept
+	{
+		block = 0;
+		offset = 0;
+	}
+
+	/// <summary> Returns the memory of the unused blocks to the heap </summary>
+	void Shrink()
+	{
+		blocks.resize(std::min(blocks.size(), block + 1));
+	}
+
+	/// <summary> Returns an arena for short lived scratch memory of the calling thread </summary>
+	static Arena& Scratch()
+	{
+		static thread_local Arena arena;
+		return arena;
+	}
+};
+
+/// <summary> Deleter of ArenaPtr, destructs the object and gives its memory back to the arena </summary>
+template <typename T>
+struct ArenaDelete
+{
+	Arena* arena = nullptr;
+
+	inline void operator ()(T* ptr) const noexcept
+	{
+		ptr->~T();
+		arena->Free(ptr, sizeof(T));
+	}
+};
+
+/// <summary> Owns an object constructed in an arena, destructs it and gives its memory back to the arena when leaving the scope </summary>
+/// <template name="T"> Type of the object </template>
+template <typename T>
+class ArenaPtr : public ScopedPtr<T, false, ArenaDelete<T>>
+{
+public:
+	ArenaPtr() = default;
+
+	/// <summary> Constructs a new object in the arena </summary>
+	template <typename... Args>
+	explicit ArenaPtr(Arena& arena, Args&&... args) : ScopedPtr<T, false, ArenaDelete<T>>(arena.New<T>(std::forward<Args>(args)...), ArenaDelete<T>{ &arena })
+	{ }
+};
@@ -0,0 +1,136 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+//Windows headers
+#include <Windows.h>
+#else
+//Linux headers
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary> Read-only view of a whole file, pages are loaded by the OS on first access </summary>
+class MappedFile
+{
+protected:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int file = -1;
+#endif
+public:
+	MappedFile() = default;
+
+	/// <summary> Maps the file, check IsOpen for the result </summary>
+	MappedFile(const std::string& filename)
+	{
+		Open(filename);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	/// <summary> Maps the file, closing the one mapped before </summary>
+	/// <returns> False if the file couldn't be opened or mapped </returns>
+	const bool Open(const std::string& filename)
+	{
+		Close();
+#ifdef _WIN32
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER length;
+		if (!GetFileSizeEx(file, &length)) return Close(), false;
+		size = (size_t)length.QuadPart;
+		if (size == 0) return true;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) return Close(), false;
+		data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		file = open(filename.c_str(), O_RDONLY);
+		if (file == -1) return false;
+		struct stat info;
+		if (fstat(file, &info) != 0) return Close(), false;
+		size = (size_t)info.st_size;
+		if (size == 0) return true;
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		data = view == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(view);
+#endif
+		if (!data) return Close(), false;
+		return true;
+	}
+
+	void Close() noexcept
+	{
+#ifdef _WIN32
+		if (data) UnmapViewOfFile(data);
+		if (mapping != NULL) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data) munmap(const_cast<uint8_t*>(data), size);
+		if (file != -1) close(file);
+		file = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	inline const bool IsOpen() const noexcept
+	{
+#ifdef _WIN32
+		return file != INVALID_HANDLE_VALUE;
+#else
+		return file != -1;
+#endif
+	}
+
+	/// <summary> Returns the contents, nullptr for empty files </summary>
+	inline const uint8_t* GetData() const noexcept
+	{
+		return data;
+	}
+
+	inline const size_t& GetSize() const noexcept
+	{
+		return size;
+	}
+};
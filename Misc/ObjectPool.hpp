@@ -0,0 +1,197 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "ScopedPtr.hpp"
+
+/// <summary> Fixed size object pool, freed objects are reused without touching the heap </summary>
+/// <template name="T"> Type of the objects </template>
+/// <template name="B"> Number of objects allocated at once </template>
+template <typename T, size_t B = 64>
+class ObjectPool
+{
+protected:
+	union Slot
+	{
+		Slot* next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+	std::vector<std::unique_ptr<Slot[]>> blocks;
+	Slot* free = nullptr; //Head of the free list
+	std::mutex mutex;
+
+	/// <summary> Takes up to count slots from the free list </summary>
+	/// <returns> Number of slots taken </returns>
+	size_t Take(Slot** out, const size_t count)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t taken = 0;
+		while (taken < count)
+		{
+			if (free == nullptr)
+			{
+				blocks.emplace_back(new Slot[B]);
+				Slot* block = blocks.back().get();
+				for (size_t i = 0; i < B; i++) block[i].next = i + 1 < B ? &block[i + 1] : nullptr;
+				free = block;
+			}
+			out[taken++] = free;
+			free = free->next;
+		}
+		return taken;
+	}
+
+	/// <summary> Puts a linked list of slots back on the free list </summary>
+	void Give(Slot* first, Slot* last)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		last->next = free;
+		free = first;
+	}
+public:
+	/// <summary> Per thread cache of free slots, refilled from and flushed to the pool in groups to avoid locking on every call </summary>
+	class Cache
+	{
+		ObjectPool& pool;
+		Slot* slots[B];
+		size_t count = 0;
+	public:
+		Cache(ObjectPool& pool) : pool(pool)
+		{ }
+
+		Cache(const Cache&) = delete;
+		Cache& operator = (const Cache&) = delete;
+
+		~Cache()
+		{
+			Flush(0);
+		}
+
+		/// <summary> Constructs an object from the cache </summary>
+		template <typename... Args>
+		T* New(Args&&... args)
+		{
+			if (count == 0) count = pool.Take(slots, B / 2 ? B / 2 : 1);
+			Slot* slot = slots[--count];
+			try
+			{
+				return new (slot->storage) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				slots[count++] = slot;
+				throw;
+			}
+		}
+
+		/// <summary> Destructs an object and keeps its slot in the cache </summary>
+		void Delete(T* object)
+		{
+			if (object == nullptr) return;
+			object->~T();
+			if (count == B) Flush(B / 2);
+			slots[count++] = reinterpret_cast<Slot*>(object);
+		}
+	private:
+		/// <summary> Returns cached slots to the pool until keep remains </summary>
+		void Flush(const size_t keep)
+		{
+			if (count <= keep) return;
+			for (size_t i = keep; i + 1 < count; i++) slots[i]->next = slots[i + 1];
+			pool.Give(slots[keep], slots[count - 1]);
+			count = keep;
+		}
+	};
+
+	ObjectPool() = default;
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator = (const ObjectPool&) = delete;
+
+	/// <summary> Constructs an object from the pool </summary>
+	template <typename... Args>
+	T* New(Args&&... args)
+	{
+		Slot* slot;
+		Take(&slot, 1);
+		try
+		{
+			return new (slot->storage) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			Give(slot, slot);
+			throw;
+		}
+	}
+
+	/// <summary> Destructs an object and returns its slot to the pool </summary>
+	void Delete(T* object)
+	{
+		if (object == nullptr) return;
+		object->~T();
+		Slot* slot = reinterpret_cast<Slot*>(object);
+		Give(slot, slot);
+	}
+
+	/// <summary> Returns the number of slots allocated so far </summary>
+	const size_t GetCapacity()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return blocks.size() * B;
+	}
+};
+
+/// <summary> Deleter of PoolPtr, returns the object to its pool </summary>
+template <typename T, size_t B = 64>
+struct PoolDelete
+{
+	ObjectPool<T, B>* pool = nullptr;
+
+	inline void operator ()(T* ptr) const
+	{
+		pool->Delete(ptr);
+	}
+};
+
+/// <summary> Owns an object of an ObjectPool and returns it to the pool when leaving the scope </summary>
+/// <template name="T"> Type of the object </template>
+/// <template name="B"> Block size of the pool </template>
+template <typename T, size_t B = 64>
+class PoolPtr : public ScopedPtr<T, false, PoolDelete<T, B>>
+{
+public:
+	PoolPtr() = default;
+
+	/// <summary> Constructs a new object from the pool </summary>
+	template <typename... Args>
+	explicit PoolPtr(ObjectPool<T, B>& pool, Args&&... args) : ScopedPtr<T, false, PoolDelete<T, B>>(pool.New(std::forward<Args>(args)...), PoolDelete<T, B>{ &pool })
+	{ }
+};
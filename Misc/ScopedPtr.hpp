@@ -21,21 +21,77 @@ LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
+
 #pragma once
+#include <cstddef>
+#include <utility>
 
-/// <summary> Scoped pointer implementation </summary>
+/// <summary> Default deleter of ScopedPtr </summary>
 /// <template name="T"> Type of the pointer </template>
 /// <template name="A"> True if the pointer is array </template>
 template <typename T, bool A = false>
-class ScopedPtr
+struct DefaultDelete
+{
+	inline void operator ()(T* ptr) const noexcept
+	{
+		delete ptr;
+	}
+};
+
+template <typename T>
+struct DefaultDelete<T, true>
+{
+	inline void operator ()(T* ptr) const noexcept
+	{
+		delete[] ptr;
+	}
+};
+
+template <typename T>
+struct DefaultDelete<T[], false> : DefaultDelete<T, true>
+{ };
+
+/// <summary> Move only scoped pointer implementation </summary>
+/// <template name="T"> Type of the pointer, T[] is the same as setting A </template>
+/// <template name="A"> True if the pointer is array </template>
+/// <template name="D"> Deleter, stateless deleters take no space </template>
+template <typename T, bool A = false, typename D = DefaultDelete<T, A>>
+class ScopedPtr : private D
 {
-public:
 	T* ptr = nullptr; //Stored pointer
-	
+public:
+	ScopedPtr() noexcept = default;
+
 	/// <summary> Initializes the stored pointer to the given pointer </summary>
-	ScopedPtr(T* ptr) : ptr(ptr)
+	ScopedPtr(T* ptr) noexcept : ptr(ptr)
+	{ }
+
+	/// <summary> Initializes the stored pointer and the deleter </summary>
+	ScopedPtr(T* ptr, const D& deleter) noexcept : D(deleter), ptr(ptr)
+	{ }
+
+	ScopedPtr(const ScopedPtr&) = delete;
+	ScopedPtr& operator = (const ScopedPtr&) = delete;
+
+	/// <summary> Takes the ownership of the other pointer </summary>
+	ScopedPtr(ScopedPtr&& other) noexcept : D(std::move(other.GetDeleter())), ptr(other.Release())
 	{ }
 
+	/// <summary> Frees the stored pointer and takes the ownership of the other pointer </summary>
+	ScopedPtr& operator = (ScopedPtr&& other) noexcept
+	{
+		Reset(other.Release());
+		GetDeleter() = std::move(other.GetDeleter());
+		return *this;
+	}
+
+	/// <summary> Frees the stored pointer and sets the given one </summary>
+	inline ScopedPtr& operator = (T* ptr) noexcept
+	{
+		Reset(ptr);
+		return *this;
+	}
+
 	/// <summary> Casting to the type of the stored pointer </summary>
 	/// <returns> Stored pointer </returns>
 	inline operator T* () const noexcept
@@ -43,13 +99,6 @@ public:
 		return ptr;
 	}
 
-	/// <summary> Sets the stored pointer </summary>
-	void operator = (T* ptr) noexcept
-	{
-		if (ptr != nullptr) delete this->ptr;
-		this->ptr = ptr;
-	}
-
 	/// <summary> Returns the object the stored pointer points to </summary>
 	/// <returns> Pointed object </returns>
 	inline T& operator *() const noexcept
@@ -58,7 +107,7 @@ public:
 	}
 
 	/// <summary> References the functions of the stored pointer </summary>
-	/// <returns> True on success </returns>
+	/// <returns> Stored pointer </returns>
 	inline T* operator ->() const noexcept
 	{
 		return ptr;
@@ -66,14 +115,61 @@ public:
 
 	/// <summary> Returns true if the stored pointer is valid </summary>
 	/// <returns> State of the pointer </returns>
-	inline operator bool() const noexcept
+	inline explicit operator bool() const noexcept
 	{
-		return ptr == nullptr;
+		return ptr != nullptr;
+	}
+
+	/// <summary> Returns the stored pointer </summary>
+	inline T* Get() const noexcept
+	{
+		return ptr;
+	}
+
+	/// <summary> Gives up the ownership without freeing the memory </summary>
+	/// <returns> Stored pointer </returns>
+	inline T* Release() noexcept
+	{
+		T* result = ptr;
+		ptr = nullptr;
+		return result;
+	}
+
+	/// <summary> Frees the stored pointer and sets the given one </summary>
+	inline void Reset(T* value = nullptr) noexcept
+	{
+		T* old = ptr;
+		ptr = value;
+		if (old != nullptr && old != value) GetDeleter()(old);
+	}
+
+	inline D& GetDeleter() noexcept
+	{
+		return *this;
+	}
+
+	inline const D& GetDeleter() const noexcept
+	{
+		return *this;
 	}
 
 	/// <summary> Frees the memory if necessary </summary>
 	~ScopedPtr()
 	{
-		if (ptr != nullptr) delete ptr;
+		if (ptr != nullptr) GetDeleter()(ptr);
 	}
-};
\ No newline at end of file
+};
+
+/// <summary> Array form, ScopedPtr<T[]> is the same as ScopedPtr<T, true> </summary>
+template <typename T, typename D>
+class ScopedPtr<T[], false, D> : public ScopedPtr<T, true, D>
+{
+public:
+	using ScopedPtr<T, true, D>::ScopedPtr;
+	using ScopedPtr<T, true, D>::operator =;
+};
+
+//A scoped pointer with a stateless deleter has to cost as much as a raw pointer
+static_assert(sizeof(ScopedPtr<int>) == sizeof(int*), "ScopedPtr is larger than a raw pointer");
+static_assert(sizeof(ScopedPtr<int, true>) == sizeof(int*), "ScopedPtr is larger than a raw pointer");
+static_assert(sizeof(ScopedPtr<int[]>) == sizeof(int*), "ScopedPtr is larger than a raw pointer");
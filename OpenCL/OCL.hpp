@@ -2,11 +2,12 @@
 
 #include <CL/cl.h>
 
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
 
-#include "ScopedPtr.hpp"
+#include "Arena.hpp"
 
 namespace ocl
 {
@@ -99,16 +100,18 @@ namespace ocl
 	std::vector<OCLDevice> GetDevices()
 	{
 		std::vector<OCLDevice> output;
+		Arena& scratch = Arena::Scratch();
+		Arena::Scope scope(scratch);
 		cl_uint platformCount;
 		clGetPlatformIDs(0, nullptr, &platformCount); //get size
-		ScopedPtr<cl_platform_id> platforms(new cl_platform_id[platformCount]);
+		cl_platform_id* platforms = scratch.Allocate<cl_platform_id>(platformCount);
 		clGetPlatformIDs(platformCount, platforms, &platformCount);
 
 		for (int p = 0; p < platformCount; p++)
 		{
 			cl_uint deviceCount;
 			clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, nullptr, &deviceCount); //get size
-			ScopedPtr<cl_device_id> devices(new cl_device_id[deviceCount]);
+			cl_device_id* devices = scratch.Allocate<cl_device_id>(deviceCount);
 			clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, deviceCount, devices, nullptr);
 
 			for (int d = 0; d < deviceCount; d++)
@@ -119,10 +122,10 @@ namespace ocl
 				t.id = devices[d];
 
 				//Get name
-				cl_uint charCount;
+				size_t charCount;
 				clGetDeviceInfo(devices[d], CL_DEVICE_NAME, 0, nullptr, &charCount); //Get size first
 
-				ScopedPtr<char> name(new char[charCount]);
+				char* name = scratch.Allocate<char>(charCount);
 				clGetDeviceInfo(devices[d], CL_DEVICE_NAME, charCount, name, nullptr);
 
 				t.name = std::string(name, charCount-1);
@@ -236,8 +239,10 @@ namespace ocl
 			}
 
 			cl_int ret;
-			ScopedPtr<char> src(new char[source.size() + 1]);
-			strcpy_s(src, source.size() + 1, source.c_str());
+			Arena& scratch = Arena::Scratch();
+			Arena::Scope scope(scratch);
+			char* src = scratch.Allocate<char>(source.size() + 1);
+			memcpy(src, source.c_str(), source.size() + 1);
 			size_t s = source.size() * sizeof(char) + 1;
 			program = clCreateProgramWithSource(ctx.ctx, 1, (const char**)& src, (const size_t*)& s, &ret);
 			if (ret != CL_SUCCESS) throw std::exception("Failed to create program");
@@ -248,7 +253,7 @@ namespace ocl
 				size_t log_size;
 				clGetProgramBuildInfo(program,ctx.deviceId, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
 
-				char* log = (char*)malloc(log_size);
+				char* log = scratch.Allocate<char>(log_size);
 
 				clGetProgramBuildInfo(program, ctx.deviceId, CL_PROGRAM_BUILD_LOG, log_size, log, NULL);
 
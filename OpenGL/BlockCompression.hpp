@@ -0,0 +1,364 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace gl
+{
+	/// <summary> CPU encoder and decoder of the S3TC formats: BC1 (DXT1), BC2 (DXT3) and BC3 (DXT5). Images are RGBA8, blocks are 4x4 pixels. </summary>
+	class BlockCompression
+	{
+	public:
+		/// <summary> Returns true for the DXT1, DXT3 and DXT5 formats, with or without sRGB </summary>
+		static const bool IsS3TC(const GLenum format) noexcept
+		{
+			switch (format)
+			{
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+				return true;
+			}
+			return false;
+		}
+
+		/// <summary> Returns 8 for DXT1 and 16 for DXT3 and DXT5 </summary>
+		static const size_t GetBlockBytes(const GLenum format) noexcept
+		{
+			return IsBC1(format) ? 8 : 16;
+		}
+
+		/// <summary> Returns the size of an image compressed with an S3TC format </summary>
+		static const size_t GetSize(const GLenum format, const size_t width, const size_t height) noexcept
+		{
+			return ((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+		}
+
+		/// <summary> Compresses an RGBA8 image, the blocks at the right and bottom edges repeat the last pixels </summary>
+		/// <param name="format"> DXT1 formats keep only the color, DXT3 and DXT5 the alpha too </param>
+		/// <param name="blocks"> GetSize(format, width, height) bytes </param>
+		static void Compress(const GLenum format, const uint8_t* pixels, const size_t width, const size_t height, uint8_t* blocks) noexcept
+		{
+			const size_t bytes = GetBlockBytes(format);
+			uint8_t block[64];
+			for (size_t by = 0; by < height; by += 4)
+				for (size_t bx = 0; bx < width; bx += 4, blocks += bytes)
+				{
+					for (size_t y = 0; y < 4; y++)
+						for (size_t x = 0; x < 4; x++)
+							memcpy(block + (y * 4 + x) * 4, pixels + (std::min(by + y, height - 1) * width + std::min(bx + x, width - 1)) * 4, 4);
+					if (IsBC1(format)) EncodeColor(block, blocks);
+					else
+					{
+						if (IsBC2(format)) EncodeExplicitAlpha(block, blocks);
+						else EncodeAlpha(block, blocks);
+						EncodeColor(block, blocks + 8);
+					}
+				}
+		}
+
+		/// <summary> Decompresses an S3TC image to RGBA8 </summary>
+		/// <param name="pixels"> width * height * 4 bytes </param>
+		static void Decompress(const GLenum format, const uint8_t* blocks, const size_t width, const size_t height, uint8_t* pixels) noexcept
+		{
+			const size_t bytes = GetBlockBytes(format);
+			uint8_t block[64];
+			for (size_t by = 0; by < height; by += 4)
+				for (size_t bx = 0; bx < width; bx += 4, blocks += bytes)
+				{
+					if (IsBC1(format)) DecodeColor(blocks, block, true);
+					else
+					{
+						DecodeColor(blocks + 8, block, false);
+						if (IsBC2(format)) DecodeExplicitAlpha(blocks, block);
+						else DecodeAlpha(blocks, block);
+					}
+					for (size_t y = 0; y < 4 && by + y < height; y++)
+						memcpy(pixels + ((by + y) * width + bx) * 4, block + y * 16, std::min<size_t>(4, width - bx) * 4);
+				}
+		}
+
+		/// <summary> Encodes the colors of 16 RGBA pixels to a BC1 block, the endpoints are fit along the principal axis of the colors </summary>
+		static void EncodeColor(const uint8_t* rgba, uint8_t* block) noexcept
+		{
+			//Principal axis by power iteration on the covariance
+			float mean[3] = {}, cov[6] = {};
+			for (size_t i = 0; i < 16; i++)
+				for (size_t c = 0; c < 3; c++) mean[c] += rgba[i * 4 + c] / 16.f;
+			for (size_t i = 0; i < 16; i++)
+			{
+				const float r = rgba[i * 4] - mean[0], g = rgba[i * 4 + 1] - mean[1], b = rgba[i * 4 + 2] - mean[2];
+				cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+				cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+			}
+			float axis[3] = { 0.9f, 1.f, 0.7f };
+			for (size_t iteration = 0; iteration < 8; iteration++)
+			{
+				const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+				const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+				const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+				const float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+				if (length < 1e-6f) break;
+				axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+			}
+
+			//Extremes along the axis, inset a little because the ends are rarely hit exactly
+			float low = 1e9f, high = -1e9f;
+			for (size_t i = 0; i < 16; i++)
+			{
+				const float t = (rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+				low = std::min(low, t);
+				high = std::max(high, t);
+			}
+			const float norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+			const float inset = (high - low) / 16.f;
+			float end0[3], end1[3];
+			for (size_t c = 0; c < 3; c++)
+			{
+				end0[c] = mean[c] + axis[c] * (high - inset) / (norm > 0.f ? norm : 1.f);
+				end1[c] = mean[c] + axis[c] * (low + inset) / (norm > 0.f ? norm : 1.f);
+			}
+			uint16_t c0 = Pack565(end0), c1 = Pack565(end1);
+			uint32_t indices = Fit(rgba, c0, c1);
+
+			//One least squares pass: solve for the endpoints that best reproduce the chosen indices
+			float aa = 0.f, bb = 0.f, ab = 0.f, ax[3] = {}, bx[3] = {};
+			static const float weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+			for (size_t i = 0; i < 16; i++)
+			{
+				const float a = weights[(indices >> (i * 2)) & 3], b = 1.f - a;
+				aa += a * a; bb += b * b; ab += a * b;
+				for (size_t c = 0; c < 3; c++)
+				{
+					ax[c] += a * rgba[i * 4 + c];
+					bx[c] += b * rgba[i * 4 + c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if (std::fabs(det) > 1e-6f)
+			{
+				for (size_t c = 0; c < 3; c++)
+				{
+					end0[c] = (ax[c] * bb - bx[c] * ab) / det;
+					end1[c] = (bx[c] * aa - ax[c] * ab) / det;
+				}
+				const uint16_t r0 = Pack565(end0), r1 = Pack565(end1);
+				const uint32_t refined = Fit(rgba, r0, r1);
+				if (Error(rgba, r0, r1, refined) < Error(rgba, c0, c1, indices))
+				{
+					c0 = r0;
+					c1 = r1;
+					indices = refined;
+				}
+			}
+
+			//Four color mode needs c0 > c1
+			if (c0 < c1)
+			{
+				std::swap(c0, c1);
+				indices ^= 0x55555555; //Swaps 0 with 1 and 2 with 3
+			}
+			else if (c0 == c1) indices = 0;
+			memcpy(block, &c0, 2);
+			memcpy(block + 2, &c1, 2);
+			memcpy(block + 4, &indices, 4);
+		}
+
+		/// <summary> Encodes the alpha of 16 RGBA pixels to a BC3 alpha block </summary>
+		static void EncodeAlpha(const uint8_t* rgba, uint8_t* block) noexcept
+		{
+			uint8_t high = 0, low = 255;
+			for (size_t i = 0; i < 16; i++)
+			{
+				high = std::max(high, rgba[i * 4 + 3]);
+				low = std::min(low, rgba[i * 4 + 3]);
+			}
+			uint8_t palette[8];
+			AlphaPalette(high, low, palette);
+			uint64_t indices = 0;
+			for (size_t i = 0; i < 16; i++)
+			{
+				uint64_t best = 0;
+				int bestError = 256;
+				for (size_t p = 0; p < 8; p++)
+				{
+					const int error = std::abs((int)palette[p] - rgba[i * 4 + 3]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= best << (i * 3);
+			}
+			block[0] = high;
+			block[1] = low;
+			for (size_t i = 0; i < 6; i++) block[2 + i] = (uint8_t)(indices >> (i * 8));
+		}
+
+		/// <summary> Encodes the alpha of 16 RGBA pixels to a BC2 block, 4 bits each </summary>
+		static void EncodeExplicitAlpha(const uint8_t* rgba, uint8_t* block) noexcept
+		{
+			for (size_t i = 0; i < 8; i++)
+				block[i] = (uint8_t)(((rgba[i * 8 + 3] * 15 + 127) / 255) | (((rgba[i * 8 + 7] * 15 + 127) / 255) << 4));
+		}
+
+		/// <summary> Decodes a BC1 color block to 16 RGBA pixels </summary>
+		/// <param name="threeColor"> Allows the three color mode with transparent black, only BC1 has it </param>
+		static void DecodeColor(const uint8_t* block, uint8_t* rgba, const bool threeColor) noexcept
+		{
+			uint16_t c0, c1;
+			uint32_t indices;
+			memcpy(&c0, block, 2);
+			memcpy(&c1, block + 2, 2);
+			memcpy(&indices, block + 4, 4);
+			uint8_t palette[16];
+			Palette(c0, c1, threeColor, palette);
+			for (size_t i = 0; i < 16; i++) memcpy(rgba + i * 4, palette + ((indices >> (i * 2)) & 3) * 4, 4);
+		}
+
+		/// <summary> Decodes a BC3 alpha block into the alpha of 16 RGBA pixels </summary>
+		static void DecodeAlpha(const uint8_t* block, uint8_t* rgba) noexcept
+		{
+			uint8_t palette[8];
+			AlphaPalette(block[0], block[1], palette);
+			uint64_t indices = 0;
+			for (size_t i = 0; i < 6; i++) indices |= (uint64_t)block[2 + i] << (i * 8);
+			for (size_t i = 0; i < 16; i++) rgba[i * 4 + 3] = palette[(indices >> (i * 3)) & 7];
+		}
+
+		/// <summary> Decodes a BC2 alpha block into the alpha of 16 RGBA pixels </summary>
+		static void DecodeExplicitAlpha(const uint8_t* block, uint8_t* rgba) noexcept
+		{
+			for (size_t i = 0; i < 16; i++) rgba[i * 4 + 3] = ((block[i / 2] >> ((i & 1) * 4)) & 15) * 17;
+		}
+	protected:
+		static const bool IsBC1(const GLenum format) noexcept
+		{
+			return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+				|| format == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+		}
+
+		static const bool IsBC2(const GLenum format) noexcept
+		{
+			return format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+		}
+
+		static uint16_t Pack565(const float* rgb) noexcept
+		{
+			const auto channel = [](const float value, const int bits) { return (uint16_t)std::min(std::max((int)std::lround(value * ((1 << bits) - 1) / 255.f), 0), (1 << bits) - 1); };
+			return (uint16_t)((channel(rgb[0], 5) << 11) | (channel(rgb[1], 6) << 5) | channel(rgb[2], 5));
+		}
+
+		/// <summary> Colors of a BC1 block as RGBA, the order of the indices </summary>
+		static void Palette(const uint16_t c0, const uint16_t c1, const bool threeColor, uint8_t* palette) noexcept
+		{
+			const auto unpack = [](const uint16_t c, uint8_t* out)
+			{
+				const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+				out[0] = (uint8_t)((r << 3) | (r >> 2));
+				out[1] = (uint8_t)((g << 2) | (g >> 4));
+				out[2] = (uint8_t)((b << 3) | (b >> 2));
+				out[3] = 255;
+			};
+			unpack(c0, palette);
+			unpack(c1, palette + 4);
+			for (size_t c = 0; c < 3; c++)
+			{
+				if (c0 > c1 || !threeColor)
+				{
+					palette[8 + c] = (uint8_t)((2 * palette[c] + palette[4 + c]) / 3);
+					palette[12 + c] = (uint8_t)((palette[c] + 2 * palette[4 + c]) / 3);
+				}
+				else
+				{
+					palette[8 + c] = (uint8_t)((palette[c] + palette[4 + c]) / 2);
+					palette[12 + c] = 0;
+				}
+			}
+			palette[11] = 255;
+			palette[15] = c0 > c1 || !threeColor ? 255 : 0;
+		}
+
+		static void AlphaPalette(const uint8_t a0, const uint8_t a1, uint8_t* palette) noexcept
+		{
+			palette[0] = a0;
+			palette[1] = a1;
+			if (a0 > a1)
+				for (size_t i = 2; i < 8; i++) palette[i] = (uint8_t)(((8 - i) * a0 + (i - 1) * a1) / 7);
+			else
+			{
+				for (size_t i = 2; i < 6; i++) palette[i] = (uint8_t)(((6 - i) * a0 + (i - 1) * a1) / 5);
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+		}
+
+		/// <summary> Picks the nearest palette color for each pixel </summary>
+		static uint32_t Fit(const uint8_t* rgba, const uint16_t c0, const uint16_t c1) noexcept
+		{
+			uint8_t palette[16];
+			Palette(std::max(c0, c1), std::min(c0, c1), false, palette);
+			uint32_t indices = 0;
+			for (size_t i = 0; i < 16; i++)
+			{
+				uint32_t best = 0;
+				int bestError = 1 << 30;
+				for (uint32_t p = 0; p < 4; p++)
+				{
+					const int r = palette[p * 4] - rgba[i * 4], g = palette[p * 4 + 1] - rgba[i * 4 + 1], b = palette[p * 4 + 2] - rgba[i * 4 + 2];
+					const int error = r * r + g * g + b * b;
+					if (error < bestError)
+					{
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= best << (i * 2);
+			}
+			//The palette was built with the larger endpoint first
+			return c0 < c1 ? indices ^ 0x55555555 : indices;
+		}
+
+		static int Error(const uint8_t* rgba, const uint16_t c0, const uint16_t c1, const uint32_t indices) noexcept
+		{
+			uint8_t palette[16];
+			Palette(c0, c1, false, palette);
+			int error = 0;
+			for (size_t i = 0; i < 16; i++)
+			{
+				const uint8_t* color = palette + ((indices >> (i * 2)) & 3) * 4;
+				for (size_t c = 0; c < 3; c++) error += (color[c] - rgba[i * 4 + c]) * (color[c] - rgba[i * 4 + c]);
+			}
+			return error;
+		}
+	};
+}
@@ -0,0 +1,92 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+#include "StateCache.hpp"
+
+namespace gl
+{
+	/// <summary> Buffer of per-instance attributes (e.g. the matrices of Transformables), written in bulk once per frame.
+	/// Attach it to a VertexArray with AddInstanceAttrib. </summary>
+	class InstanceBuffer
+	{
+	protected:
+		GLuint id;
+		size_t capacity = 0; //Bytes allocated
+		size_t count = 0; //Instances in the last Write
+	public:
+		InstanceBuffer()
+		{
+			if (GLEW_ARB_direct_state_access) glCreateBuffers(1, &id); //Usable by VertexLayout before the first Write
+			else glGenBuffers(1, &id);
+		}
+
+		InstanceBuffer(const InstanceBuffer&) = delete;
+		InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+		~InstanceBuffer()
+		{
+			StateCache::Current().ForgetBuffer(id);
+			glDeleteBuffers(1, &id);
+		}
+
+		/// <summary> Replaces the contents with count instances of size bytes each. The old storage is orphaned, so draws still using it don't stall the write. </summary>
+		void Write(const void* data, const size_t count, const size_t size) noexcept
+		{
+			const size_t bytes = count * size;
+			Bind();
+			if (bytes > capacity) capacity = bytes + bytes / 2;
+			glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+			if (bytes) glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+			this->count = count;
+		}
+
+		template <typename T>
+		inline void Write(const std::vector<T>& instances) noexcept
+		{
+			Write(instances.data(), instances.size(), sizeof(T));
+		}
+
+		inline void Bind() const noexcept
+		{
+			StateCache::Current().BindBuffer(GL_ARRAY_BUFFER, id);
+		}
+
+		/// <summary> Returns the number of instances of the last Write </summary>
+		inline const size_t GetCount() const noexcept
+		{
+			return count;
+		}
+
+		inline const GLuint& GetId() const noexcept
+		{
+			return id;
+		}
+	};
+}
@@ -0,0 +1,383 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Arena.hpp"
+
+namespace gl
+{
+	/// <summary> Prepares indexed triangle lists for drawing at load time: merges equal vertices, reorders the triangles for the post-transform vertex cache and to reduce overdraw, then the vertices for fetch locality </summary>
+	class MeshOptimizer
+	{
+	public:
+		/// <summary> Result of Optimize, ACMR is the average number of vertices transformed per triangle (0.5 to 3, lower is better) </summary>
+		struct Report
+		{
+			size_t verticesBefore = 0;
+			size_t verticesAfter = 0;
+			float acmrBefore = 0.f;
+			float acmrAfter = 0.f;
+		};
+
+		/// <summary> Runs every step in order: Deduplicate, OptimizeVertexCache, OptimizeOverdraw, ReorderVertices </summary>
+		/// <param name="indices"> Triangle list, generated if empty </param>
+		/// <param name="position"> Member holding the position of the vertex </param>
+		/// <param name="threshold"> ACMR the overdraw pass may lose, 1.05 allows 5% (Optional) </param>
+		/// <param name="cacheSize"> Entries of the simulated vertex cache (Optional) </param>
+		template <typename V>
+		static Report Optimize(std::vector<V>& vertices, std::vector<uint32_t>& indices, glm::fvec3 V::* position, const float threshold = 1.05f, const uint32_t cacheSize = 32)
+		{
+			Report report;
+			report.verticesBefore = vertices.size();
+			report.acmrBefore = indices.empty() ? 3.f : ACMR(indices, vertices.size(), cacheSize);
+			Deduplicate(vertices, indices);
+			OptimizeVertexCache(indices, vertices.size(), cacheSize);
+			OptimizeOverdraw(indices, vertices, position, threshold, cacheSize);
+			ReorderVertices(vertices, indices);
+			report.verticesAfter = vertices.size();
+			report.acmrAfter = ACMR(indices, vertices.size(), cacheSize);
+			return report;
+		}
+
+		/// <summary> Merges vertices with the same bytes, padding of V has to be zeroed </summary>
+		/// <param name="indices"> Triangle list, if empty the vertices are taken as an unindexed triangle list and the indices are generated </param>
+		template <typename V>
+		static void Deduplicate(std::vector<V>& vertices, std::vector<uint32_t>& indices)
+		{
+			static_assert(std::is_trivially_copyable<V>::value, "[class MeshOptimizer] Vertices are compared by their bytes");
+			if (indices.empty())
+			{
+				indices.resize(vertices.size());
+				for (size_t i = 0; i < indices.size(); i++) indices[i] = (uint32_t)i;
+			}
+
+			Arena::Scope scope(Arena::Scratch());
+			const size_t capacity = Capacity(vertices.size());
+			uint32_t* table = Arena::Scratch().Allocate<uint32_t>(capacity); //Index into unique, or Empty
+			uint32_t* remap = Arena::Scratch().Allocate<uint32_t>(vertices.size());
+			std::fill(table, table + capacity, Empty);
+
+			std::vector<V> unique;
+			unique.reserve(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				size_t slot = Hash(&vertices[i], sizeof(V)) & (capacity - 1);
+				while (table[slot] != Empty && std::memcmp(&unique[table[slot]], &vertices[i], sizeof(V)) != 0)
+					slot = (slot + 1) & (capacity - 1);
+				if (table[slot] == Empty)
+				{
+					table[slot] = (uint32_t)unique.size();
+					unique.push_back(vertices[i]);
+				}
+				remap[i] = table[slot];
+			}
+			for (uint32_t& index : indices) index = remap[index];
+			vertices.swap(unique);
+		}
+
+		/// <summary> Reorders the triangles so consecutive ones share vertices still in the post-transform cache (Forsyth's linear-speed algorithm) </summary>
+		/// <param name="cacheSize"> Entries of the simulated LRU cache, larger than the real cache does little harm (Optional) </param>
+		static void OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize = 32)
+		{
+			const size_t triangles = indices.size() / 3;
+			if (triangles == 0 || cacheSize < 4) return;
+			Arena::Scope scope(Arena::Scratch());
+			Arena& arena = Arena::Scratch();
+
+			//Triangles of each vertex, the live ones are kept at the front of the range
+			uint32_t* first = arena.Allocate<uint32_t>(vertexCount + 1);
+			uint32_t* live = arena.Allocate<uint32_t>(vertexCount);
+			uint32_t* adjacency = arena.Allocate<uint32_t>(triangles * 3);
+			//Degenerate triangles are listed once per distinct vertex
+			const auto repeated = [&](const size_t t, const size_t k) { return (k > 0 && indices[t * 3 + k] == indices[t * 3]) || (k > 1 && indices[t * 3 + k] == indices[t * 3 + 1]); };
+			std::fill(live, live + vertexCount, 0u);
+			for (size_t t = 0; t < triangles; t++)
+				for (size_t k = 0; k < 3; k++)
+					if (!repeated(t, k)) live[indices[t * 3 + k]]++;
+			first[0] = 0;
+			for (size_t v = 0; v < vertexCount; v++) first[v + 1] = first[v] + live[v];
+			std::fill(live, live + vertexCount, 0u);
+			for (size_t t = 0; t < triangles; t++)
+				for (size_t k = 0; k < 3; k++)
+				{
+					const uint32_t v = indices[t * 3 + k];
+					if (!repeated(t, k)) adjacency[first[v] + live[v]++] = (uint32_t)t;
+				}
+
+			int32_t* position = arena.Allocate<int32_t>(vertexCount); //In the cache, -1 if not cached
+			float* vertexScore = arena.Allocate<float>(vertexCount);
+			bool* emitted = arena.Allocate<bool>(triangles);
+			std::fill(position, position + vertexCount, -1);
+			std::fill(emitted, emitted + triangles, false);
+			for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = Score(-1, live[v], cacheSize);
+
+			//The cache holds 3 more entries while a triangle is added
+			uint32_t* cache = arena.Allocate<uint32_t>(cacheSize + 3);
+			uint32_t* next = arena.Allocate<uint32_t>(cacheSize + 3);
+			uint32_t cached = 0;
+
+			std::vector<uint32_t> result(indices.size());
+			size_t scan = 0; //Triangles before it are all emitted
+			int64_t best = -1;
+			for (size_t out = 0; out < triangles; out++)
+			{
+				if (best < 0)
+				{
+					//Nothing adjacent to the cache, continue with the first triangle not emitted yet
+					while (emitted[scan]) scan++;
+					best = (int64_t)scan;
+				}
+				const uint32_t t = (uint32_t)best;
+				emitted[t] = true;
+				std::memcpy(&result[out * 3], &indices[t * 3], 3 * sizeof(uint32_t));
+
+				//Move the vertices of the triangle to the front of the cache and take the triangle off their live lists
+				uint32_t count = 0;
+				for (size_t k = 0; k < 3; k++)
+				{
+					const uint32_t v = indices[t * 3 + k];
+					if (std::find(next, next + count, v) != next + count) continue;
+					next[count++] = v;
+					uint32_t* begin = adjacency + first[v];
+					uint32_t* end = begin + live[v];
+					std::iter_swap(std::find(begin, end, t), end - 1);
+					live[v]--;
+				}
+				for (uint32_t i = 0; i < cached; i++)
+					if (std::find(next, next + count, cache[i]) == next + count) next[count++] = cache[i];
+				for (uint32_t i = cacheSize; i < count; i++) position[next[i]] = -1;
+				cached = std::min(count, cacheSize);
+				std::swap(cache, next);
+
+				//Rescore the cached and the evicted vertices, then the live triangles around them
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const uint32_t v = cache[i];
+					if (i < cached) position[v] = (int32_t)i;
+					vertexScore[v] = Score(position[v], live[v], cacheSize);
+				}
+				best = -1;
+				float bestScore = 0.f;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const uint32_t v = cache[i];
+					for (uint32_t a = first[v]; a < first[v] + live[v]; a++)
+					{
+						const uint32_t u = adjacency[a];
+						const float score = vertexScore[indices[u * 3]] + vertexScore[indices[u * 3 + 1]] + vertexScore[indices[u * 3 + 2]];
+						if (score > bestScore)
+						{
+							bestScore = score;
+							best = u;
+						}
+					}
+				}
+			}
+			indices.swap(result);
+		}
+
+		/// <summary> Splits the triangles into clusters without hurting the vertex cache much, then draws the clusters facing away from the center first so the outer surfaces occlude the rest (Sander et al.). Front faces are taken as counter-clockwise. Run after OptimizeVertexCache. </summary>
+		/// <param name="position"> Member holding the position of the vertex </param>
+		/// <param name="threshold"> ACMR the clusters may lose, 1.05 allows 5% (Optional) </param>
+		template <typename V>
+		static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<V>& vertices, glm::fvec3 V::* position, const float threshold = 1.05f, const uint32_t cacheSize = 32)
+		{
+			const size_t triangles = indices.size() / 3;
+			if (triangles < 2) return;
+			Arena::Scope scope(Arena::Scratch());
+			Arena& arena = Arena::Scratch();
+			uint32_t* stamps = arena.Allocate<uint32_t>(vertices.size());
+			uint32_t time = cacheSize + 1;
+			std::fill(stamps, stamps + vertices.size(), 0u);
+
+			//Hard boundaries: triangles that miss on all vertices start a new cluster, ordering there costs nothing
+			std::vector<uint32_t> hard;
+			for (size_t t = 0; t < triangles; t++)
+				if (CacheMisses(&indices[t * 3], stamps, time, cacheSize) == 3 || t == 0) hard.push_back((uint32_t)t);
+			hard.push_back((uint32_t)triangles);
+
+			//Soft boundaries: split a hard cluster again whenever the part so far is within threshold of its ACMR
+			std::vector<uint32_t> clusters;
+			for (size_t h = 0; h + 1 < hard.size(); h++)
+			{
+				const uint32_t begin = hard[h], end = hard[h + 1];
+				time += cacheSize + 1;
+				uint32_t misses = 0;
+				for (uint32_t t = begin; t < end; t++) misses += CacheMisses(&indices[t * 3], stamps, time, cacheSize);
+				const float target = threshold * misses / (end - begin);
+
+				clusters.push_back(begin);
+				time += cacheSize + 1;
+				uint32_t runningMisses = 0, runningTriangles = 0;
+				for (uint32_t t = begin; t < end; t++)
+				{
+					runningMisses += CacheMisses(&indices[t * 3], stamps, time, cacheSize);
+					runningTriangles++;
+					if (t + 1 < end && (float)runningMisses / runningTriangles <= target)
+					{
+						clusters.push_back(t + 1);
+						time += cacheSize + 1;
+						runningMisses = runningTriangles = 0;
+					}
+				}
+			}
+			clusters.push_back((uint32_t)triangles);
+			const size_t count = clusters.size() - 1;
+			if (count < 2) return;
+
+			//Sort the clusters by how far they face out of the mesh, the outermost first
+			glm::fvec3 center(0.f);
+			float area = 0.f;
+			struct Cluster
+			{
+				float key;
+				uint32_t begin, end;
+			};
+			Cluster* sorted = arena.Allocate<Cluster>(count);
+			glm::fvec3* centroids = arena.Allocate<glm::fvec3>(count);
+			glm::fvec3* normals = arena.Allocate<glm::fvec3>(count);
+			for (size_t c = 0; c < count; c++)
+			{
+				glm::fvec3 centroid(0.f), normal(0.f);
+				float clusterArea = 0.f;
+				for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+				{
+					const glm::fvec3& a = vertices[indices[t * 3]].*position;
+					const glm::fvec3& b = vertices[indices[t * 3 + 1]].*position;
+					const glm::fvec3& d = vertices[indices[t * 3 + 2]].*position;
+					const glm::fvec3 n = glm::cross(b - a, d - a); //Length is twice the area
+					const float triangleArea = glm::length(n);
+					centroid = centroid + (a + b + d) * (triangleArea / 3.f);
+					normal = normal + n;
+					clusterArea += triangleArea;
+				}
+				center = center + centroid;
+				area += clusterArea;
+				centroids[c] = clusterArea > 0.f ? centroid / clusterArea : centroid;
+				const float length = glm::length(normal);
+				normals[c] = length > 0.f ? normal / length : normal;
+			}
+			if (area > 0.f) center = center / area;
+			for (size_t c = 0; c < count; c++)
+				sorted[c] = { glm::dot(centroids[c] - center, normals[c]), clusters[c], clusters[c + 1] };
+			std::stable_sort(sorted, sorted + count, [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+			std::vector<uint32_t> result;
+			result.reserve(indices.size());
+			for (size_t c = 0; c < count; c++)
+				result.insert(result.end(), indices.begin() + sorted[c].begin * 3, indices.begin() + sorted[c].end * 3);
+			indices.swap(result);
+		}
+
+		/// <summary> Orders the vertices as the indices first use them, unused vertices are dropped </summary>
+		template <typename V>
+		static void ReorderVertices(std::vector<V>& vertices, std::vector<uint32_t>& indices)
+		{
+			Arena::Scope scope(Arena::Scratch());
+			uint32_t* remap = Arena::Scratch().Allocate<uint32_t>(vertices.size());
+			std::fill(remap, remap + vertices.size(), Empty);
+			std::vector<V> ordered;
+			ordered.reserve(vertices.size());
+			for (uint32_t& index : indices)
+			{
+				if (remap[index] == Empty)
+				{
+					remap[index] = (uint32_t)ordered.size();
+					ordered.push_back(vertices[index]);
+				}
+				index = remap[index];
+			}
+			vertices.swap(ordered);
+		}
+
+		/// <summary> Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache </summary>
+		static float ACMR(const std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize = 32)
+		{
+			const size_t triangles = indices.size() / 3;
+			if (triangles == 0) return 0.f;
+			Arena::Scope scope(Arena::Scratch());
+			uint32_t* stamps = Arena::Scratch().Allocate<uint32_t>(vertexCount);
+			std::fill(stamps, stamps + vertexCount, 0u);
+			uint32_t time = cacheSize + 1;
+			size_t misses = 0;
+			for (size_t t = 0; t < triangles; t++) misses += CacheMisses(&indices[t * 3], stamps, time, cacheSize);
+			return (float)misses / triangles;
+		}
+
+	protected:
+		static constexpr uint32_t Empty = 0xFFFFFFFF;
+
+		/// <summary> Forsyth's vertex score: recently used vertices and vertices with few triangles left score higher </summary>
+		static float Score(const int32_t position, const uint32_t live, const uint32_t cacheSize) noexcept
+		{
+			if (live == 0) return -1.f;
+			float score = 0.f;
+			if (position >= 0)
+			{
+				//The last triangle's vertices score a bit lower, so the strip doesn't turn back on itself
+				if (position < 3) score = 0.75f;
+				else score = std::pow(1.f - (float)(position - 3) / (cacheSize - 3), 1.5f);
+			}
+			return score + 2.f / std::sqrt((float)live);
+		}
+
+		/// <summary> Simulates a FIFO cache with timestamps, a vertex is cached if it was added in the last cacheSize misses </summary>
+		static uint32_t CacheMisses(const uint32_t* triangle, uint32_t* stamps, uint32_t& time, const uint32_t cacheSize) noexcept
+		{
+			uint32_t misses = 0;
+			for (size_t k = 0; k < 3; k++)
+			{
+				if (time - stamps[triangle[k]] <= cacheSize) continue;
+				stamps[triangle[k]] = time++;
+				misses++;
+			}
+			return misses;
+		}
+
+		static size_t Capacity(const size_t count) noexcept
+		{
+			size_t capacity = 16;
+			while (capacity < count * 2) capacity <<= 1;
+			return capacity;
+		}
+
+		/// <summary> FNV-1a </summary>
+		static size_t Hash(const void* data, const size_t size) noexcept
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			uint64_t hash = 14695981039346656037ULL;
+			for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+			return (size_t)(hash ^ (hash >> 32));
+		}
+	};
+}
@@ -0,0 +1,230 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_SSE2
+#endif
+
+namespace gl
+{
+	/// <summary> Builds mip chains of RGBA8 images on the CPU with a 2x2 box filter. Colors are averaged in linear space
+	/// when they are sRGB encoded, alpha always linearly. Uses SSE2 when the compiler targets it. </summary>
+	class MipmapGenerator
+	{
+	public:
+		/// <summary> Returns the number of levels down to 1x1 </summary>
+		static const GLint GetLevelCount(const size_t width, const size_t height) noexcept
+		{
+			GLint levels = 1;
+			for (size_t size = std::max(width, height); size > 1; size >>= 1) levels++;
+			return levels;
+		}
+
+		/// <summary> Returns the bytes of every level after the first </summary>
+		static const size_t GetChainSize(size_t width, size_t height) noexcept
+		{
+			size_t bytes = 0;
+			while (width > 1 || height > 1)
+			{
+				width = std::max<size_t>(1, width / 2);
+				height = std::max<size_t>(1, height / 2);
+				bytes += width * height * 4;
+			}
+			return bytes;
+		}
+
+		/// <summary> Writes the levels after the first one after the other </summary>
+		/// <param name="chain"> GetChainSize(width, height) bytes </param>
+		/// <param name="srgb"> Colors are sRGB encoded, true for images loaded from files </param>
+		static void Generate(const uint8_t* pixels, size_t width, size_t height, uint8_t* chain, const bool srgb = true) noexcept
+		{
+			while (width > 1 || height > 1)
+			{
+				Downsample(pixels, width, height, chain, srgb);
+				pixels = chain;
+				width = std::max<size_t>(1, width / 2);
+				height = std::max<size_t>(1, height / 2);
+				chain += width * height * 4;
+			}
+		}
+
+		/// <summary> Halves an RGBA8 image, odd last rows and columns are dropped </summary>
+		/// <param name="out"> (width / 2) * (height / 2) pixels, at least 1 in each direction </param>
+		static void Downsample(const uint8_t* pixels, const size_t width, const size_t height, uint8_t* out, const bool srgb = true) noexcept
+		{
+			const size_t w = std::max<size_t>(1, width / 2), h = std::max<size_t>(1, height / 2);
+			for (size_t y = 0; y < h; y++)
+			{
+				const uint8_t* row0 = pixels + std::min(y * 2, height - 1) * width * 4;
+				const uint8_t* row1 = pixels + std::min(y * 2 + 1, height - 1) * width * 4;
+				uint8_t* dst = out + y * w * 4;
+				size_t x = 0;
+				if (width > 1)
+				{
+					if (srgb) x = RowSRGB(row0, row1, dst, w);
+					else x = RowLinear(row0, row1, dst, w);
+				}
+				for (; x < w; x++)
+				{
+					const size_t x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+					for (size_t c = 0; c < 4; c++)
+					{
+						if (srgb && c < 3)
+						{
+							const float sum = ToLinear()[row0[x0 + c]] + ToLinear()[row0[x1 + c]] + ToLinear()[row1[x0 + c]] + ToLinear()[row1[x1 + c]];
+							dst[x * 4 + c] = ToSRGB(sum * 0.25f);
+						}
+						else dst[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+					}
+				}
+			}
+		}
+	protected:
+		static const float* ToLinear() noexcept
+		{
+			static const struct Table
+			{
+				float values[256];
+				Table()
+				{
+					for (int i = 0; i < 256; i++)
+					{
+						const float c = i / 255.f;
+						values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+					}
+				}
+			} table;
+			return table.values;
+		}
+
+		static uint8_t ToSRGB(const float linear) noexcept
+		{
+			static const struct Table
+			{
+				uint8_t values[4096];
+				Table()
+				{
+					for (int i = 0; i < 4096; i++)
+					{
+						const float l = i / 4095.f;
+						const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+						values[i] = (uint8_t)std::lround(std::min(std::max(c, 0.f), 1.f) * 255.f);
+					}
+				}
+			} table;
+			return table.values[(size_t)(std::min(std::max(linear, 0.f), 1.f) * 4095.f + 0.5f)];
+		}
+
+#if defined(MIPMAP_SSE2)
+		/// <summary> Linear to sRGB with a fit of the power curve on square roots, within one step of the table </summary>
+		template <typename V, typename Ops>
+		static inline V Encode(const V l, const Ops& o) noexcept
+		{
+			const V s1 = o.sqrt(l), s2 = o.sqrt(s1), s3 = o.sqrt(s2);
+			const V curve = o.sub(o.add(o.mul(s1, o.set(0.585122381f)), o.mul(s2, o.set(0.783140355f))), o.mul(s3, o.set(0.368262736f)));
+			return o.select(o.le(l, o.set(0.0031308f)), o.mul(l, o.set(12.92f)), curve);
+		}
+
+		static size_t RowLinear(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, const size_t w) noexcept
+		{
+			//Rounded average of the 4 bytes of every channel, 4 output pixels at a time
+			const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+			size_t x = 0;
+			for (; x + 4 <= w; x += 4)
+			{
+				const __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8)), a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+				const __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8)), b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+				//Vertical sums as 16 bit, then add the horizontal neighbours (pixels 2i and 2i+1)
+				const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+				const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+				const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+				const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+				const __m128i p0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8)), p1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+				const __m128i p2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8)), p3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+				const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(p0, p1), two), 2);
+				const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(p2, p3), two), 2);
+				_mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(lo, hi));
+			}
+			return x;
+		}
+#endif
+
+#if defined(MIPMAP_SSE2)
+		struct Ops
+		{
+			inline __m128 set(const float v) const noexcept { return _mm_set1_ps(v); }
+			inline __m128 add(const __m128 a, const __m128 b) const noexcept { return _mm_add_ps(a, b); }
+			inline __m128 sub(const __m128 a, const __m128 b) const noexcept { return _mm_sub_ps(a, b); }
+			inline __m128 mul(const __m128 a, const __m128 b) const noexcept { return _mm_mul_ps(a, b); }
+			inline __m128 sqrt(const __m128 a) const noexcept { return _mm_sqrt_ps(a); }
+			inline __m128 le(const __m128 a, const __m128 b) const noexcept { return _mm_cmple_ps(a, b); }
+			inline __m128 select(const __m128 mask, const __m128 a, const __m128 b) const noexcept { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		};
+
+		/// <summary> Loads 1 pixel, colors through the table and alpha as 0-1 </summary>
+		static inline __m128 Load1(const uint8_t* p, const float* table) noexcept
+		{
+			return _mm_setr_ps(table[p[0]], table[p[1]], table[p[2]], p[3] * (1.f / 255.f));
+		}
+
+		static size_t RowSRGB(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, const size_t w) noexcept
+		{
+			const Ops o;
+			const float* table = ToLinear();
+			const __m128 alpha = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+			for (size_t x = 0; x < w; x++)
+			{
+				const __m128 sum = _mm_add_ps(_mm_add_ps(Load1(row0 + x * 8, table), Load1(row0 + x * 8 + 4, table)),
+					_mm_add_ps(Load1(row1 + x * 8, table), Load1(row1 + x * 8 + 4, table)));
+				const __m128 average = _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+				const __m128 value = o.select(alpha, average, Encode(average, o));
+				const __m128i i = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.f)), _mm_set1_ps(255.f)));
+				const __m128i packed = _mm_packs_epi32(i, i);
+				const int32_t bits = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+				memcpy(dst + x * 4, &bits, 4);
+			}
+			return w;
+		}
+#else
+		static size_t RowSRGB(const uint8_t*, const uint8_t*, uint8_t*, const size_t) noexcept
+		{
+			return 0;
+		}
+
+		static size_t RowLinear(const uint8_t*, const uint8_t*, uint8_t*, const size_t) noexcept
+		{
+			return 0;
+		}
+#endif
+	};
+}
@@ -0,0 +1,167 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <chrono>
+#include <csetjmp>
+#include <cstring>
+#include <string>
+#include <png.h>
+
+#include "Exception.hpp"
+#include "Arena.hpp"
+#include "MappedFile.hpp"
+
+namespace gl
+{
+	/// <summary> Decodes a PNG from a mapped file in two steps: the constructor reads the header so the caller can find memory for the pixels, Read decodes into it.
+	/// Palette, grayscale and 16 bit images are converted to 8 bit RGB or RGBA. Safe to use on any thread. </summary>
+	class PngReader
+	{
+	protected:
+		MappedFile file;
+		size_t position = 0; //Next byte libpng reads
+		png_structp png = nullptr;
+		png_infop info = nullptr;
+		png_uint_32 width = 0, height = 0;
+		int colorType = 0, bitDepth = 0;
+		bool alpha = false;
+	public:
+		/// <summary> Maps the file and reads the header </summary>
+		PngReader(const std::string& filename)
+		{
+			E_THROW_IF(!file.Open(filename), Exception::File_NotFound, "File " + filename + " could not be found!")
+			if (file.GetSize() < 8 || png_sig_cmp(file.GetData(), 0, 8) != 0)
+			{
+				Close();
+				throw Exception(Exception::File_Broken, "File header validation failed");
+			}
+			png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+			if (png) info = png_create_info_struct(png);
+			if (!info)
+			{
+				Close();
+				throw Exception(Exception::File_Broken, "Failed to create the PNG reader");
+			}
+			if (setjmp(png_jmpbuf(png)))
+			{
+				Close();
+				throw Exception(Exception::File_Broken, "Failed to read the header of " + filename);
+			}
+			position = 8;
+			png_set_read_fn(png, this, &PngReader::ReadData);
+			png_set_sig_bytes(png, 8);
+			png_read_info(png, info);
+			png_get_IHDR(png, info, &width, &height, &bitDepth, &colorType, nullptr, nullptr, nullptr);
+
+			//Everything becomes 8 bit RGB, or RGBA if the image has any transparency
+			alpha = (colorType & PNG_COLOR_MASK_ALPHA) || png_get_valid(png, info, PNG_INFO_tRNS);
+			if (colorType == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+			if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) png_set_expand_gray_1_2_4_to_8(png);
+			if (png_get_valid(png, info, PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png);
+			if (bitDepth == 16) png_set_strip_16(png);
+			if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+			png_set_interlace_handling(png);
+		}
+
+		PngReader(const PngReader&) = delete;
+		PngReader& operator=(const PngReader&) = delete;
+
+		~PngReader()
+		{
+			Close();
+		}
+
+		/// <summary> Decodes the image, the last row first to match the bottom-up order of GL textures </summary>
+		/// <param name="pixels"> Memory for height rows of stride bytes </param>
+		/// <param name="stride"> Bytes between the starts of two rows </param>
+		/// <param name="rgba"> Adds an opaque alpha channel to images without one </param>
+		void Read(unsigned char* pixels, const size_t stride, const bool rgba)
+		{
+			Arena::Scope scope(Arena::Scratch());
+			png_bytepp rows = Arena::Scratch().Allocate<png_bytep>(height);
+			for (png_uint_32 i = 0; i < height; i++) rows[height - 1 - i] = pixels + i * stride;
+			if (setjmp(png_jmpbuf(png)))
+			{
+				Close();
+				throw Exception(Exception::File_Broken, "Failed to decode the image");
+			}
+			if (rgba && !alpha) png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+			png_read_update_info(png, info);
+			png_read_image(png, rows);
+			png_read_end(png, nullptr);
+		}
+
+		inline const png_uint_32& GetWidth() const noexcept
+		{
+			return width;
+		}
+
+		inline const png_uint_32& GetHeight() const noexcept
+		{
+			return height;
+		}
+
+		/// <summary> Returns true if the decoded image has an alpha channel, including palette and grayscale images with transparency </summary>
+		inline const bool HasAlpha() const noexcept
+		{
+			return alpha;
+		}
+
+		/// <summary> Decodes a file repeatedly into scratch memory </summary>
+		/// <returns> Decoded RGBA megabytes per second </returns>
+		static const double Benchmark(const std::string& filename, const size_t iterations = 16)
+		{
+			size_t bytes = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < iterations; i++)
+			{
+				PngReader reader(filename);
+				const size_t stride = (size_t)reader.GetWidth() * 4;
+				Arena::Scope scope(Arena::Scratch());
+				reader.Read(Arena::Scratch().Allocate<unsigned char>(stride * reader.GetHeight()), stride, true);
+				bytes += stride * reader.GetHeight();
+			}
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return bytes / 1e6 / seconds;
+		}
+	protected:
+		static void ReadData(png_structp png, png_bytep out, png_size_t length)
+		{
+			PngReader* reader = static_cast<PngReader*>(png_get_io_ptr(png));
+			if (length > reader->file.GetSize() - reader->position) png_error(png, "Unexpected end of file");
+			memcpy(out, reader->file.GetData() + reader->position, length);
+			reader->position += length;
+		}
+
+		void Close() noexcept
+		{
+			if (png) png_destroy_read_struct(&png, info ? &info : nullptr, nullptr);
+			png = nullptr;
+			info = nullptr;
+			file.Close();
+		}
+	};
+}
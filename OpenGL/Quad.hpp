@@ -8,22 +8,23 @@
 class Quad : public gl::Transformable, protected gl::VertexArray, public gl::Drawable
 {
 public:
+	typedef gl::VertexLayout<gl::Attr<glm::fvec2>, gl::Attr<glm::fvec2>> Layout; //Position, uv
+
 	Quad()
 	{
 		const GLfloat vertices[] = {
-			0.0,0.0,
-			0.0,1.0,
-			1.0,1.0,
-			1.0,0.0
+			0.0,0.0, 0.0,0.0,
+			0.0,1.0, 0.0,1.0,
+			1.0,1.0, 1.0,1.0,
+			1.0,0.0, 1.0,0.0
 		};
 		this->FillBuffer(vertices, sizeof(vertices));
-		this->AddAttribPointer(0, 2, 0);//vertices
-		this->AddAttribPointer(1, 2, 2);//uv
+		this->SetLayout<Layout>();
 	}
 
 	virtual void Draw(gl::Uniform& uniform) const
 	{
 		uniform.SetMat4f(matrix);
-		DrawArray(GL_TRIANGLE_STRIP);
+		DrawArray(GL_TRIANGLE_FAN);
 	}
 };
\ No newline at end of file
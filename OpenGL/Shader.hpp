@@ -4,11 +4,19 @@
 #include <string>
 #include <array>
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <fstream>
+#include <cstdio>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Exception.hpp"
-#include "ScopedPtr.hpp"
+#include "Arena.hpp"
+#include "StateCache.hpp"
 
 namespace gl
 {
@@ -18,49 +26,96 @@ namespace gl
 	{
 	private:
 		const Shader* parent;
-		const GLuint id;
+		const GLint id;
+		std::string name;
+		GLenum type;
+		GLint size;
+		mutable uint8_t shadow[sizeof(glm::fmat4)]; //Last value sent to GL
+		mutable bool cached = false;
+		const Uniform* owner = nullptr; //Uniform of the same location that holds the shadow copy, nullptr if this one does
 	protected:
 		friend Shader;
-		Uniform(const Shader* parent,const GLuint& location) : parent(parent), id(location)
+		Uniform(const Shader* parent, const GLint& location, const std::string_view name, const GLenum type = GL_NONE, const GLint size = 0) : parent(parent), id(location), name(name), type(type), size(size)
 		{
 
 		}
+
+		/// <summary> Updates the shadow copy </summary>
+		/// <returns> False if the value is the same as the last one, so the GL call can be skipped </returns>
+		template <typename V>
+		inline const bool Changed(const V& value) const noexcept
+		{
+			static_assert(sizeof(V) <= sizeof(shadow), "Uniform value too large for the shadow copy");
+			const Uniform& holder = owner ? *owner : *this;
+			if (holder.cached && memcmp(holder.shadow, &value, sizeof(V)) == 0) return false;
+			memcpy(holder.shadow, &value, sizeof(V));
+			holder.cached = true;
+			return true;
+		}
 	public:
 		inline void SetInt(const GLint value) const
 		{
-			glUniform1i(id, value);
+			if (Changed(value)) glUniform1i(id, value);
 		}
 		inline void SetFloat(const GLfloat value) const
 		{
-			glUniform1f(id, value);
+			if (Changed(value)) glUniform1f(id, value);
 		}
 		inline void SetVec2i(const glm::ivec2 value) const
 		{
-			glUniform2i(id, value.x, value.y);
+			if (Changed(value)) glUniform2i(id, value.x, value.y);
 		}
 		inline void SetVec2f(const glm::fvec2 value) const
 		{
-			glUniform2f(id, value.x, value.y);
+			if (Changed(value)) glUniform2f(id, value.x, value.y);
 		}
 		inline void SetVec3i(const glm::ivec3 value) const
 		{
-			glUniform3i(id, value.x, value.y, value.z);
+			if (Changed(value)) glUniform3i(id, value.x, value.y, value.z);
 		}
 		inline void SetVec3f(const glm::fvec3 value) const
 		{
-			glUniform3f(id, value.x, value.y, value.z);
+			if (Changed(value)) glUniform3f(id, value.x, value.y, value.z);
 		}
 		inline void SetMat4f(const glm::fmat4 value) const
 		{
-			glUniformMatrix4fv(id, 1, GL_FALSE, glm::value_ptr(value));
+			if (Changed(value)) glUniformMatrix4fv(id, 1, GL_FALSE, glm::value_ptr(value));
 		}
 		inline void SetMat3f(const glm::fmat3 value) const
 		{
-			glUniformMatrix3fv(id, 1, GL_FALSE, glm::value_ptr(value));
+			if (Changed(value)) glUniformMatrix3fv(id, 1, GL_FALSE, glm::value_ptr(value));
 		}
 		inline void SetMat2f(const glm::fmat2 value) const
 		{
-			glUniformMatrix2fv(id, 1, GL_FALSE, glm::value_ptr(value));
+			if (Changed(value)) glUniformMatrix2fv(id, 1, GL_FALSE, glm::value_ptr(value));
+		}
+
+		/// <summary> Forgets the shadow copy, the next set always reaches GL </summary>
+		inline void Invalidate() const noexcept
+		{
+			(owner ? owner : this)->cached = false;
+		}
+
+		inline const GLint& GetLocation() const noexcept
+		{
+			return id;
+		}
+
+		inline const std::string& GetName() const noexcept
+		{
+			return name;
+		}
+
+		/// <summary> Returns the GL type of the uniform, GL_NONE if it wasn't found by reflection </summary>
+		inline const GLenum& GetType() const noexcept
+		{
+			return type;
+		}
+
+		/// <summary> Returns the number of array elements, 0 if it wasn't found by reflection </summary>
+		inline const GLint& GetSize() const noexcept
+		{
+			return size;
 		}
 	};
 
@@ -74,7 +129,11 @@ namespace gl
 	protected:
 		GLuint id;
 		std::string sources[TYPE_MAX];
-		std::vector<Uniform> uniforms;
+		std::deque<Uniform> uniforms; //Never shrinks until the next Compile, so references stay valid
+		std::vector<int32_t> uniformTable; //Open addressing hash table of indices into uniforms, -1 is empty
+		GLuint shaders[TYPE_MAX] = {}; //Attached while CompileAsync is pending
+		uint64_t key = 0; //Binary cache key of the sources
+		bool pending = false;
 	public:
 		Shader()
 		{
@@ -83,6 +142,8 @@ namespace gl
 
 		~Shader()
 		{
+			ReleaseStages();
+			StateCache::Current().ForgetProgram(id);
 			glDeleteProgram(id);
 		}
 
@@ -91,28 +152,105 @@ namespace gl
 			sources[type] = source;
 		}
 
+		/// <summary> Compiles and links the program, blocks until it's done </summary>
 		void Compile()
 		{
-			//Compile vertex shader
+			CompileAsync();
+			Finish();
+		}
+
+		/// <summary> Starts compiling and linking the program without waiting for the driver. Programs found in the binary cache are loaded instead. Check with IsReady, complete with Finish. </summary>
+		void CompileAsync()
+		{
+			key = CacheKey();
+			if (LoadBinary())
+			{
+				for (auto& source : sources) source.clear();
+				Reflect();
+				return;
+			}
+
+			if (!CacheDirectory().empty() && GLEW_ARB_get_program_binary)
+				glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+			//Compile shaders, errors are checked in Finish so the driver can work in the background
 			for (uint8_t i = 0; i < TYPE_MAX; i++)
 			{
 				if (sources[i].empty()) continue;
 				const GLuint shader = glCreateShader(i==Vertex ? GL_VERTEX_SHADER : (i == Fragment ? GL_FRAGMENT_SHADER : GL_GEOMETRY_SHADER));
 				glShaderSource(shader, 1, &std::array<const char*, 1> {  this->sources[i].c_str() }[0], nullptr);
 				glCompileShader(shader);
-				E_RETHROW(CheckShaderCompileErrors(shader, static_cast<Type>(i)));
 				glAttachShader(id, shader);
-				glDeleteShader(shader);
+				shaders[i] = shader;
 				sources[i].clear();
 			}
 			//Link program
 			glLinkProgram(id);
+			pending = true;
+		}
+
+		/// <summary> Checks if the program started by CompileAsync is done, without blocking if the driver supports parallel compilation </summary>
+		const bool IsReady() const
+		{
+			if (!pending) return true;
+			if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile) return true;
+			GLint done = GL_FALSE;
+			glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &done);
+			return done == GL_TRUE;
+		}
+
+		/// <summary> Waits for the program started by CompileAsync, checks for errors and stores the binary in the cache </summary>
+		void Finish()
+		{
+			if (!pending) return;
+			pending = false;
+
+			//The stages are released when leaving, also if one of them failed to compile
+			struct Stages
+			{
+				Shader& shader;
+				~Stages()
+				{
+					shader.ReleaseStages();
+				}
+			} stages{ *this };
+
+			GLint linked = GL_FALSE;
+			glGetProgramiv(id, GL_LINK_STATUS, &linked);
+			for (uint8_t i = 0; i < TYPE_MAX; i++)
+				if (shaders[i] && !linked) E_RETHROW(CheckShaderCompileErrors(shaders[i], static_cast<Type>(i)));
+			ReleaseStages();
 			E_RETHROW(CheckLinkerErrors(id));
+			StoreBinary();
+			Reflect();
+		}
+
+		/// <summary> Sets the directory of the program binary cache, empty disables it (default) </summary>
+		static void SetCacheDirectory(const std::string directory)
+		{
+			CacheDirectory() = directory;
+		}
+
+		/// <summary> Sets the number of threads the driver may use for compiling shaders in the background </summary>
+		static void SetCompilerThreads(const GLuint count)
+		{
+			if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(count);
+			else if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(count);
 		}
 
 		inline void Use() const
 		{
-			glUseProgram(id);
+			StateCache::Current().UseProgram(id);
+		}
+
+		/// <summary> Connects a uniform block of the program to a binding point, where a UniformBuffer can be bound. Programs sharing a binding point share the buffer. </summary>
+		/// <returns> False if the program has no such block </returns>
+		const bool BindUniformBlock(const std::string_view name, const GLuint binding) const
+		{
+			const GLuint index = glGetUniformBlockIndex(id, std::string(name).c_str());
+			if (index == GL_INVALID_INDEX) return false;
+			glUniformBlockBinding(id, index, binding);
+			return true;
 		}
 
 		const GLuint& GetId() const noexcept
@@ -120,12 +258,180 @@ namespace gl
 			return id;
 		}
 
-		Uniform& GetUniform(std::string variable)
+		/// <summary> Finds a uniform of the program. Active uniforms are found by reflection after Compile, other names (like single array elements) are looked up once and cached. </summary>
+		/// <returns> Reference valid until the next Compile </returns>
+		Uniform& GetUniform(const std::string_view variable)
 		{
-			uniforms.push_back(Uniform(this, glGetUniformLocation(id, variable.c_str())));
-			return uniforms.back();
+			Finish();
+			if (!uniformTable.empty())
+			{
+				const size_t mask = uniformTable.size() - 1;
+				for (size_t i = Hash(variable) & mask; uniformTable[i] != -1; i = (i + 1) & mask)
+					if (uniforms[uniformTable[i]].name == variable) return uniforms[uniformTable[i]];
+			}
+
+			//Not reflected, ask GL once and remember the answer
+			const std::string name(variable);
+			uniforms.push_back(Uniform(this, glGetUniformLocation(id, name.c_str()), variable));
+			Uniform& uniform = uniforms.back();
+
+			//Names of the same location (like "lights" and "lights[0]") share one shadow copy, so neither can go stale
+			if (uniform.id != -1)
+				for (size_t i = 0; i + 1 < uniforms.size(); i++)
+					if (uniforms[i].id == uniform.id)
+					{
+						uniform.owner = uniforms[i].owner ? uniforms[i].owner : &uniforms[i];
+						break;
+					}
+			Insert(uniforms.size() - 1);
+			return uniform;
 		}
 	protected:
+		/// <summary> Detaches and deletes the shaders attached by CompileAsync </summary>
+		void ReleaseStages() noexcept
+		{
+			for (GLuint& shader : shaders)
+			{
+				if (!shader) continue;
+				glDetachShader(id, shader);
+				glDeleteShader(shader);
+				shader = 0;
+			}
+		}
+
+		/// <summary> Lists the active uniforms of the linked program </summary>
+		void Reflect()
+		{
+			uniforms.clear();
+			uniformTable.clear();
+			GLint count = 0, maxLength = 0;
+			glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+			glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+			Arena::Scope scope(Arena::Scratch());
+			char* name = Arena::Scratch().Allocate<char>(maxLength + 1);
+			for (GLint i = 0; i < count; i++)
+			{
+				GLsizei length = 0;
+				GLint size = 0;
+				GLenum type = GL_NONE;
+				glGetActiveUniform(id, i, maxLength + 1, &length, &size, &type, name);
+				const GLint location = glGetUniformLocation(id, name);
+				if (location == -1) continue; //Member of a uniform block
+
+				//Arrays are reported as name[0], they are looked up without the index
+				std::string_view view(name, length);
+				if (view.size() > 3 && view.substr(view.size() - 3) == "[0]") view.remove_suffix(3);
+				uniforms.push_back(Uniform(this, location, view, type, size));
+				Insert(uniforms.size() - 1);
+			}
+		}
+
+		/// <summary> Adds a uniform to the hash table, growing it to keep the load under one half </summary>
+		void Insert(const size_t index)
+		{
+			if (uniforms.size() * 2 > uniformTable.size())
+			{
+				size_t capacity = 16;
+				while (capacity < uniforms.size() * 2) capacity *= 2;
+				uniformTable.assign(capacity, -1);
+				for (size_t i = 0; i < index; i++) Place(i);
+			}
+			Place(index);
+		}
+
+		inline void Place(const size_t index)
+		{
+			const size_t mask = uniformTable.size() - 1;
+			size_t slot = Hash(uniforms[index].name) & mask;
+			while (uniformTable[slot] != -1) slot = (slot + 1) & mask;
+			uniformTable[slot] = (int32_t)index;
+		}
+
+		/// <summary> FNV-1a hash of a uniform name </summary>
+		static inline const uint32_t Hash(const std::string_view value) noexcept
+		{
+			uint32_t hash = 2166136261u;
+			for (const char& c : value) hash = (hash ^ (uint8_t)c) * 16777619u;
+			return hash;
+		}
+
+		static std::string& CacheDirectory()
+		{
+			static std::string directory;
+			return directory;
+		}
+
+		/// <summary> FNV-1a hash of the sources and the driver strings, a driver update invalidates the cache </summary>
+		const uint64_t CacheKey() const
+		{
+			uint64_t hash = 14695981039346656037ull;
+			const auto add = [&hash](const char* data, const size_t size)
+			{
+				for (size_t i = 0; i < size; i++) hash = (hash ^ (uint8_t)data[i]) * 1099511628211ull;
+				hash = (hash ^ 0xFF) * 1099511628211ull; //Separator
+			};
+			for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+			{
+				const char* value = reinterpret_cast<const char*>(glGetString(name));
+				if (value) add(value, strlen(value));
+			}
+			for (const auto& source : sources) add(source.data(), source.size());
+			return hash;
+		}
+
+		const std::string CachePath() const
+		{
+			std::string name(16, '0');
+			for (uint8_t i = 0; i < 16; i++) name[15 - i] = "0123456789abcdef"[(key >> (i * 4)) & 0xF];
+			return CacheDirectory() + "/" + name + ".bin";
+		}
+
+		/// <summary> Loads the program from the binary cache </summary>
+		/// <returns> False if there's no usable binary, the program has to be compiled </returns>
+		const bool LoadBinary()
+		{
+			if (CacheDirectory().empty() || !GLEW_ARB_get_program_binary) return false;
+			std::ifstream file(CachePath(), std::ios::binary | std::ios::ate);
+			if (!file) return false;
+			const std::streamoff size = file.tellg();
+			if (size <= (std::streamoff)sizeof(GLenum)) return false;
+			file.seekg(0);
+
+			Arena::Scope scope(Arena::Scratch());
+			char* data = Arena::Scratch().Allocate<char>((size_t)size);
+			if (!file.read(data, size)) return false;
+			GLenum format;
+			memcpy(&format, data, sizeof(GLenum));
+			glProgramBinary(id, format, data + sizeof(GLenum), (GLsizei)(size - sizeof(GLenum)));
+
+			GLint linked = GL_FALSE;
+			glGetProgramiv(id, GL_LINK_STATUS, &linked);
+			return linked == GL_TRUE; //Rejected binaries (e.g. after a driver update) are compiled again
+		}
+
+		/// <summary> Saves the linked program to the binary cache </summary>
+		void StoreBinary() const
+		{
+			if (CacheDirectory().empty() || !GLEW_ARB_get_program_binary) return;
+			GLint length = 0;
+			glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length <= 0) return;
+
+			Arena::Scope scope(Arena::Scratch());
+			char* data = Arena::Scratch().Allocate<char>(sizeof(GLenum) + length);
+			GLenum format = 0;
+			glGetProgramBinary(id, length, &length, &format, data + sizeof(GLenum));
+			memcpy(data, &format, sizeof(GLenum));
+
+			//Written under a temporary name so other processes never read a partial file
+			const std::string path = CachePath();
+			{
+				std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+				if (!file.write(data, sizeof(GLenum) + length)) return;
+			}
+			std::rename((path + ".tmp").c_str(), path.c_str());
+		}
 
 		static void CheckLinkerErrors(const uint32_t shader)
 		{
@@ -133,9 +439,10 @@ namespace gl
 			glGetProgramiv(shader, GL_LINK_STATUS, &success);
 			if (!success)
 			{
-				ScopedPtr<char> info(new char[1024]);
-				glGetProgramInfoLog(shader, 1024, NULL, info.ptr);
-				throw Exception(Exception::Shader_LinkProgramFail,std::string(info.ptr));
+				Arena::Scope scope(Arena::Scratch());
+				char* info = Arena::Scratch().Allocate<char>(1024);
+				glGetProgramInfoLog(shader, 1024, NULL, info);
+				throw Exception(Exception::Shader_LinkProgramFail,std::string(info));
 			}
 		}
 
@@ -145,9 +452,10 @@ namespace gl
 			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 			if (!success)
 			{
-				ScopedPtr<char> info(new char[1024]);
-				glGetShaderInfoLog(shader, 1024, NULL, info.ptr);
-				throw Exception(type ? Exception::Shader_CompileVertexFail : ( type == Fragment ? Exception::Shader_CompileFragmentFail : Exception::Shader_CompileGeometryFail), std::string(info.ptr));
+				Arena::Scope scope(Arena::Scratch());
+				char* info = Arena::Scratch().Allocate<char>(1024);
+				glGetShaderInfoLog(shader, 1024, NULL, info);
+				throw Exception(type ? Exception::Shader_CompileVertexFail : ( type == Fragment ? Exception::Shader_CompileFragmentFail : Exception::Shader_CompileGeometryFail), std::string(info));
 			}
 		}
 	};
@@ -0,0 +1,260 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Exception.hpp"
+#include "ScopedPtr.hpp"
+#include "Shader.hpp"
+
+namespace gl
+{
+	/// <summary> Family of shader programs built from one source, differing in the features (#defines) enabled.
+	/// Variants are selected by a bitmask of features and compiled on first use. Variants enabling features the
+	/// sources never mention share one program. On disk caching is done by the Shader binary cache. </summary>
+	class ShaderVariants
+	{
+	public:
+		typedef uint64_t Mask;
+	protected:
+		std::string sources[Shader::TYPE_MAX]; //Includes already resolved
+		std::vector<std::string> features; //Bit i of a mask enables features[i]
+		Mask used = 0; //Features that appear in the sources
+		std::unordered_map<Mask, ScopedPtr<Shader>> variants;
+	public:
+		/// <summary> Declares a feature key, enabled variants get "#define name" </summary>
+		/// <returns> Bit of the feature </returns>
+		Mask AddFeature(const std::string_view name)
+		{
+			if (features.size() >= 64) return 0;
+			features.push_back(std::string(name));
+			UpdateUsed();
+			return Mask(1) << (features.size() - 1);
+		}
+
+		/// <summary> Returns the mask of the given feature keys, unknown keys are ignored </summary>
+		const Mask GetMask(const std::initializer_list<std::string_view> names) const noexcept
+		{
+			Mask mask = 0;
+			for (const auto& name : names)
+				for (size_t i = 0; i < features.size(); i++)
+					if (features[i] == name) mask |= Mask(1) << i;
+			return mask;
+		}
+
+		/// <summary> Sets the source of a stage, #include "file" lines are resolved relative to the directory </summary>
+		void LoadShaderFromMemory(const Shader::Type type, const std::string_view source, const std::string directory = ".")
+		{
+			std::unordered_set<std::string> included;
+			sources[type].clear();
+			Expand(source, directory, sources[type], included, 0);
+			variants.clear();
+			UpdateUsed();
+		}
+
+		/// <summary> Loads the source of a stage from a file, #include "file" lines are resolved relative to the file </summary>
+		void LoadShaderFromFile(const Shader::Type type, const std::string filename)
+		{
+			LoadShaderFromMemory(type, ReadFile(filename), Directory(filename));
+		}
+
+		/// <summary> Returns the variant with the given features, compiles it if needed </summary>
+		/// <returns> Reference valid until the sources are changed </returns>
+		Shader& Get(const Mask mask)
+		{
+			Shader& shader = Request(mask);
+			shader.Finish();
+			return shader;
+		}
+
+		/// <summary> Starts compiling variants without waiting for them, Get finishes them </summary>
+		void Prewarm(const std::initializer_list<Mask> masks)
+		{
+			for (const Mask mask : masks) Request(mask);
+		}
+
+		/// <summary> Checks if a variant is compiled and ready to use without blocking </summary>
+		const bool IsReady(const Mask mask) const
+		{
+			const auto it = variants.find(mask & used);
+			return it != variants.end() && it->second->IsReady();
+		}
+
+		/// <summary> Returns the number of distinct programs created </summary>
+		inline const size_t GetVariantCount() const noexcept
+		{
+			return variants.size();
+		}
+
+		/// <summary> Forgets the cached include files, the next load reads them again. Edited files are noticed without it by their modification time. </summary>
+		static void ClearIncludeCache()
+		{
+			IncludeCache& cache = GetIncludeCache();
+			std::lock_guard<std::mutex> lock(cache.mutex);
+			cache.files.clear();
+		}
+	protected:
+		Shader& Request(Mask mask)
+		{
+			mask &= used;
+			auto it = variants.find(mask);
+			if (it != variants.end()) return *it->second;
+
+			ScopedPtr<Shader> shader(new Shader());
+			for (uint8_t i = 0; i < Shader::TYPE_MAX; i++)
+				if (!sources[i].empty()) shader->LoadShaderFromMemory(static_cast<Shader::Type>(i), Define(sources[i], mask));
+			shader->CompileAsync();
+			return *variants.emplace(mask, std::move(shader)).first->second;
+		}
+
+		/// <summary> Inserts the #defines of the mask after the #version line </summary>
+		const std::string Define(const std::string& source, const Mask mask) const
+		{
+			size_t insert = 0, line = 1;
+			const size_t version = source.find("#version");
+			if (version != std::string::npos && source.find_first_not_of(" \t\r\n") == version)
+			{
+				insert = source.find('\n', version);
+				insert = insert == std::string::npos ? source.size() : insert + 1;
+				for (size_t i = 0; i < insert; i++) line += source[i] == '\n';
+			}
+
+			std::string output = source.substr(0, insert);
+			if (insert && output.back() != '\n') output += '\n';
+			for (size_t i = 0; i < features.size(); i++)
+				if (mask & (Mask(1) << i)) output += "#define " + features[i] + "\n";
+			output += "#line " + std::to_string(line) + "\n"; //Keep the line numbers of compile errors
+			output.append(source, insert, std::string::npos);
+			return output;
+		}
+
+		/// <summary> Copies the source to the output with the #include lines replaced by the files. Files are included once. </summary>
+		void Expand(const std::string_view source, const std::string& directory, std::string& output, std::unordered_set<std::string>& included, const uint8_t depth)
+		{
+			E_THROW_IF(depth > 32, Exception::File_Broken, "Shader includes are nested too deep");
+			size_t start = 0;
+			while (start < source.size())
+			{
+				size_t end = source.find('\n', start);
+				end = end == std::string_view::npos ? source.size() : end + 1;
+				const std::string_view line = source.substr(start, end - start);
+				start = end;
+
+				const size_t hash = line.find_first_not_of(" \t");
+				if (hash == std::string_view::npos || line.compare(hash, 8, "#include") != 0)
+				{
+					output.append(line.data(), line.size());
+					continue;
+				}
+
+				const size_t open = line.find('"'), close = line.rfind('"');
+				E_THROW_IF(open == close, Exception::File_Broken, "Malformed include: " + std::string(line));
+				const std::string path = Normalize(directory + "/" + std::string(line.substr(open + 1, close - open - 1)));
+				if (!included.insert(path).second) continue;
+				Expand(ReadInclude(path), Directory(path), output, included, depth + 1);
+				if (!output.empty() && output.back() != '\n') output += '\n';
+			}
+		}
+
+		void UpdateUsed()
+		{
+			used = 0;
+			for (size_t i = 0; i < features.size(); i++)
+				for (const auto& source : sources)
+					if (source.find(features[i]) != std::string::npos)
+					{
+						used |= Mask(1) << i;
+						break;
+					}
+		}
+
+		struct IncludeFile
+		{
+			std::filesystem::file_time_type time;
+			std::string content;
+		};
+
+		/// <summary> Included files of every ShaderVariants by normalized path, shared headers are read from disk once </summary>
+		struct IncludeCache
+		{
+			std::mutex mutex;
+			std::unordered_map<std::string, IncludeFile> files;
+		};
+
+		static IncludeCache& GetIncludeCache()
+		{
+			static IncludeCache cache;
+			return cache;
+		}
+
+		/// <summary> Reads an included file through the cache, files modified since they were cached are read again </summary>
+		static const std::string ReadInclude(const std::string& path)
+		{
+			std::error_code error;
+			const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+			IncludeCache& cache = GetIncludeCache();
+			{
+				std::lock_guard<std::mutex> lock(cache.mutex);
+				const auto it = cache.files.find(path);
+				if (it != cache.files.end() && !error && it->second.time == time) return it->second.content;
+			}
+
+			std::string content = ReadFile(path);
+			std::lock_guard<std::mutex> lock(cache.mutex);
+			if (!error) cache.files[path] = { time, content };
+			return content;
+		}
+
+		static const std::string ReadFile(const std::string& filename)
+		{
+			std::ifstream file(filename, std::ios::binary);
+			E_THROW_IF(!file, Exception::File_NotFound, "Failed to open " + filename);
+			return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		}
+
+		/// <summary> Removes "." and "dir/.." from the path, so one file has one cache entry </summary>
+		static const std::string Normalize(const std::string& path)
+		{
+			return std::filesystem::path(path).lexically_normal().generic_string();
+		}
+
+		static const std::string Directory(const std::string& filename)
+		{
+			const size_t slash = filename.find_last_of("/\\");
+			return slash == std::string::npos ? "." : filename.substr(0, slash);
+		}
+	};
+}
@@ -0,0 +1,230 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "TextureAtlas.hpp"
+#include "Transformable.hpp"
+#include "VertexArray.hpp"
+#include "VertexLayout.hpp"
+
+namespace gl
+{
+	/// <summary> Collects textured quads and draws them from one vertex buffer, with one draw call per shader and texture run </summary>
+	class SpriteBatch : protected VertexArrayDynamic
+	{
+	public:
+		enum SortMode : uint8_t
+		{
+			Sort_State, //Shader, texture, then depth. Fewest draw calls, for opaque sprites.
+			Sort_BackToFront, //Depth first (far to near), then shader and texture. For blended sprites.
+			Sort_None //Submission order
+		};
+
+		struct Vertex
+		{
+			glm::fvec2 position;
+			glm::fvec2 uv;
+			glm::u8vec4 color;
+		};
+		typedef VertexLayout<Attr<glm::fvec2>, Attr<glm::fvec2>, Attr<glm::u8vec4, true>> Layout;
+		static_assert(sizeof(Vertex) == Layout::stride, "Vertex doesn't match its layout");
+	protected:
+		struct Sprite
+		{
+			Vertex corners[4];
+			const Shader* shader;
+			const Texture* texture;
+		};
+
+		struct Key
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		Shader defaultShader;
+		SortMode mode;
+		std::vector<Sprite> sprites;
+		std::vector<Key> order;
+		std::vector<const Shader*> shaders; //Shaders seen in this batch, their index is part of the sort key
+		std::vector<Vertex> vertices;
+		size_t drawCalls = 0;
+	public:
+		/// <summary> Creates the batch </summary>
+		/// <param name="mode"> Order of the sprites in End </param>
+		SpriteBatch(const SortMode mode = Sort_State) : mode(mode)
+		{
+			defaultShader.LoadShaderFromMemory(Shader::Vertex,
+				"#version 330 core\n"
+				"layout(location = 0) in vec2 position;\n"
+				"layout(location = 1) in vec2 uv;\n"
+				"layout(location = 2) in vec4 color;\n"
+				"out vec2 fragUv;\n"
+				"out vec4 fragColor;\n"
+				"void main()\n"
+				"{\n"
+				"	fragUv = uv;\n"
+				"	fragColor = color;\n"
+				"	gl_Position = vec4(position, 0.0, 1.0);\n"
+				"}\n");
+			defaultShader.LoadShaderFromMemory(Shader::Fragment,
+				"#version 330 core\n"
+				"in vec2 fragUv;\n"
+				"in vec4 fragColor;\n"
+				"out vec4 color;\n"
+				"uniform sampler2D texture0;\n"
+				"void main()\n"
+				"{\n"
+				"	color = texture(texture0, fragUv) * fragColor;\n"
+				"}\n");
+			defaultShader.Compile();
+			defaultShader.Use();
+			defaultShader.GetUniform("texture0").SetInt(0);
+
+			EnableStreaming(1024 * 6 * sizeof(Vertex));
+			SetLayout<Layout>();
+		}
+
+		/// <summary> Starts a new batch, sprites not drawn yet are dropped </summary>
+		void Begin() noexcept
+		{
+			sprites.clear();
+			order.clear();
+			shaders.clear();
+		}
+
+		/// <summary> Adds a quad with the transformation of a Transformable (e.g. a Quad) </summary>
+		/// <param name="uv"> Texture rectangle: x, y, width, height </param>
+		/// <param name="shader"> Shader with the vertex layout of SpriteBatch::Vertex and the texture on unit 0, nullptr for the default </param>
+		void Draw(const Transformable& transformable, const Texture& texture, const glm::fvec4 uv = glm::fvec4(0.f, 0.f, 1.f, 1.f), const glm::u8vec4 color = glm::u8vec4(255), const Shader* shader = nullptr)
+		{
+			const glm::fmat4& m = transformable.GetMatrix();
+			Sprite sprite;
+			static const float corners[4][2] = { { 0.f, 0.f }, { 0.f, 1.f }, { 1.f, 1.f }, { 1.f, 0.f } };
+			for (uint8_t i = 0; i < 4; i++)
+			{
+				const float x = corners[i][0], y = corners[i][1];
+				sprite.corners[i].position = glm::fvec2(m[0][0] * x + m[1][0] * y + m[3][0], m[0][1] * x + m[1][1] * y + m[3][1]);
+				sprite.corners[i].uv = glm::fvec2(uv.x + uv.z * x, uv.y + uv.w * y);
+				sprite.corners[i].color = color;
+			}
+			sprite.shader = shader ? shader : &defaultShader;
+			sprite.texture = &texture;
+			sprites.push_back(sprite);
+			order.push_back({ SortKey(sprite.shader, texture.GetId(), m[3][2]), (uint32_t)(sprites.size() - 1) });
+		}
+
+		/// <summary> Adds a quad showing an image of a TextureAtlas with Storage_Pages, sprites on the same page share draw calls </summary>
+		inline void Draw(const Transformable& transformable, const TextureAtlas::Region& region, const glm::u8vec4 color = glm::u8vec4(255), const Shader* shader = nullptr)
+		{
+			Draw(transformable, *region.texture, region.uv, color, shader);
+		}
+
+		/// <summary> Sorts the sprites, streams them into the vertex buffer with one write and draws them </summary>
+		void End()
+		{
+			drawCalls = 0;
+			if (mode != Sort_None)
+				std::sort(order.begin(), order.end(), [](const Key& a, const Key& b) { return a.key < b.key; });
+
+			//Two triangles per sprite
+			vertices.resize(sprites.size() * 6);
+			Vertex* out = vertices.data();
+			for (const Key& key : order)
+			{
+				const Vertex* c = sprites[key.index].corners;
+				out[0] = c[0]; out[1] = c[1]; out[2] = c[2];
+				out[3] = c[0]; out[4] = c[2]; out[5] = c[3];
+				out += 6;
+			}
+
+			if (!vertices.empty()) UpdateBuffer(vertices.data(), 0, vertices.size() * sizeof(Vertex));
+
+			//One draw per run of the same shader and texture
+			size_t first = 0;
+			for (size_t i = 1; i <= order.size(); i++)
+			{
+				const Sprite& a = sprites[order[first].index];
+				if (i < order.size())
+				{
+					const Sprite& b = sprites[order[i].index];
+					if (a.shader == b.shader && a.texture == b.texture) continue;
+				}
+				a.shader->Use();
+				a.texture->Bind(0);
+				DrawArray(GL_TRIANGLES, first * 6, (i - first) * 6);
+				drawCalls++;
+				first = i;
+			}
+			NextFrame();
+			sprites.clear();
+			order.clear();
+			shaders.clear();
+		}
+
+		inline void SetSortMode(const SortMode value) noexcept
+		{
+			mode = value;
+		}
+
+		/// <summary> Returns the number of draw calls of the last End </summary>
+		inline const size_t GetDrawCalls() const noexcept
+		{
+			return drawCalls;
+		}
+
+		inline const Shader& GetDefaultShader() const noexcept
+		{
+			return defaultShader;
+		}
+	protected:
+		/// <summary> Builds the sort key: shader (8 bit), texture (24 bit) and depth (32 bit), in the order of the sort mode </summary>
+		const uint64_t SortKey(const Shader* shader, const GLuint texture, const float depth)
+		{
+			if (mode == Sort_None) return 0;
+
+			uint64_t shaderIndex = std::find(shaders.begin(), shaders.end(), shader) - shaders.begin();
+			if (shaderIndex == shaders.size()) shaders.push_back(shader);
+			const uint64_t state = (std::min<uint64_t>(shaderIndex, 0xFF) << 24) | (texture & 0xFFFFFF);
+
+			//Floats as unsigned integers with the same order
+			uint32_t bits;
+			memcpy(&bits, &depth, sizeof(bits));
+			bits = bits & 0x80000000 ? ~bits : bits | 0x80000000;
+
+			if (mode == Sort_State) return (state << 32) | bits;
+			return ((uint64_t)~bits << 32) | state; //Larger clip space z is farther, those come first
+		}
+	};
+}
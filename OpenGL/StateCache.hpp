@@ -0,0 +1,255 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstddef>
+
+namespace gl
+{
+	/// <summary> Shadow copy of the GL bindings of a context. Binds matching the current state are skipped.
+	/// Each thread uses the cache set by SetCurrent, or its own default one. Objects deleted through the
+	/// wrapper classes are forgotten, raw GL changes need Invalidate. </summary>
+	class StateCache
+	{
+	public:
+		static constexpr GLuint MaxTextureUnits = 32;
+		static constexpr GLuint MaxBufferBindings = 32; //Indexed uniform buffer binding points
+
+		struct Stats
+		{
+			size_t issued = 0; //GL calls made
+			size_t elided = 0; //GL calls skipped
+		};
+	protected:
+		static constexpr GLuint Unknown = 0xFFFFFFFF;
+
+		//Texture targets tracked per unit, other targets are always bound
+		enum TextureSlot : uint8_t
+		{
+			Slot_2D, Slot_2DArray, Slot_CubeMap, SLOT_MAX
+		};
+
+		//Buffer targets tracked, other targets are always bound
+		enum BufferSlot : uint8_t
+		{
+			Slot_Array, Slot_ElementArray, Slot_Uniform, Slot_PixelUnpack, Slot_CopyRead, Slot_CopyWrite, BUFFER_SLOT_MAX
+		};
+
+		struct IndexedBuffer
+		{
+			GLuint id;
+			GLintptr offset;
+			GLsizeiptr size; //-1 for the whole buffer
+		};
+
+		GLuint program;
+		GLuint vertexArray;
+		GLuint activeUnit;
+		GLuint textures[MaxTextureUnits][SLOT_MAX];
+		GLuint buffers[BUFFER_SLOT_MAX];
+		IndexedBuffer uniformBuffers[MaxBufferBindings];
+		Stats stats;
+	public:
+		StateCache()
+		{
+			Invalidate();
+		}
+
+		/// <summary> Returns the cache of the context current on this thread </summary>
+		static inline StateCache& Current() noexcept
+		{
+			StateCache* current = CurrentPointer();
+			if (current) return *current;
+			thread_local StateCache fallback;
+			return fallback;
+		}
+
+		/// <summary> Sets the cache used on this thread, call it together with making a context current. Nullptr selects the default cache of the thread. </summary>
+		static inline void SetCurrent(StateCache* cache) noexcept
+		{
+			CurrentPointer() = cache;
+		}
+
+		/// <summary> Forgets every binding, the next calls are all issued. Use it after GL calls made around the cache. </summary>
+		void Invalidate() noexcept
+		{
+			program = vertexArray = activeUnit = Unknown;
+			for (auto& unit : textures)
+				for (auto& texture : unit) texture = Unknown;
+			for (auto& buffer : buffers) buffer = Unknown;
+			for (auto& buffer : uniformBuffers) buffer = { Unknown, 0, 0 };
+		}
+
+		inline void UseProgram(const GLuint id) noexcept
+		{
+			if (Elide(program == id)) return;
+			glUseProgram(id);
+			stats.issued++;
+			program = id;
+		}
+
+		inline void BindVertexArray(const GLuint id) noexcept
+		{
+			if (Elide(vertexArray == id)) return;
+			glBindVertexArray(id);
+			stats.issued++;
+			vertexArray = id;
+			buffers[Slot_ElementArray] = Unknown; //Element buffer binding is part of the vertex array
+		}
+
+		inline void ActiveTexture(const GLuint unit) noexcept
+		{
+			if (Elide(activeUnit == unit)) return;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			stats.issued++;
+			activeUnit = unit;
+		}
+
+		/// <summary> Binds a texture to a texture unit for sampling. The active unit is not changed if the texture is already bound. </summary>
+		void BindTexture(const GLuint unit, const GLenum target, const GLuint id) noexcept
+		{
+			const uint8_t slot = TextureSlotOf(target);
+			if (slot != SLOT_MAX && unit < MaxTextureUnits && Elide(textures[unit][slot] == id)) return;
+			ActiveTexture(unit);
+			glBindTexture(target, id);
+			stats.issued++;
+			if (slot != SLOT_MAX && unit < MaxTextureUnits) textures[unit][slot] = id;
+		}
+
+		/// <summary> Makes the texture bound on the active unit, so glTexParameter and friends affect it </summary>
+		void BindTextureForEdit(const GLenum target, const GLuint id) noexcept
+		{
+			BindTexture(activeUnit < MaxTextureUnits ? activeUnit : 0, target, id);
+		}
+
+		void BindBuffer(const GLenum target, const GLuint id) noexcept
+		{
+			const uint8_t slot = BufferSlotOf(target);
+			if (slot != BUFFER_SLOT_MAX && Elide(buffers[slot] == id)) return;
+			glBindBuffer(target, id);
+			stats.issued++;
+			if (slot != BUFFER_SLOT_MAX) buffers[slot] = id;
+		}
+
+		/// <summary> Binds a whole buffer to an indexed binding point, also sets the generic binding like GL does </summary>
+		inline void BindBufferBase(const GLenum target, const GLuint index, const GLuint id) noexcept
+		{
+			BindBufferRange(target, index, id, 0, -1);
+		}
+
+		/// <summary> Binds a range of a buffer to an indexed binding point, size -1 binds the whole buffer </summary>
+		void BindBufferRange(const GLenum target, const GLuint index, const GLuint id, const GLintptr offset, const GLsizeiptr size) noexcept
+		{
+			const bool tracked = target == GL_UNIFORM_BUFFER && index < MaxBufferBindings;
+			if (tracked)
+			{
+				const IndexedBuffer& bound = uniformBuffers[index];
+				if (Elide(bound.id == id && bound.offset == offset && bound.size == size)) return;
+			}
+			if (size < 0) glBindBufferBase(target, index, id);
+			else glBindBufferRange(target, index, id, offset, size);
+			stats.issued++;
+			if (tracked) uniformBuffers[index] = { id, offset, size };
+			const uint8_t slot = BufferSlotOf(target);
+			if (slot != BUFFER_SLOT_MAX) buffers[slot] = id;
+		}
+
+		/// <summary> Call when a program is deleted, GL may give its name to a new one </summary>
+		void ForgetProgram(const GLuint id) noexcept
+		{
+			if (program == id) program = Unknown;
+		}
+
+		void ForgetVertexArray(const GLuint id) noexcept
+		{
+			if (vertexArray == id) vertexArray = Unknown;
+		}
+
+		void ForgetTexture(const GLuint id) noexcept
+		{
+			for (auto& unit : textures)
+				for (auto& texture : unit)
+					if (texture == id) texture = Unknown;
+		}
+
+		void ForgetBuffer(const GLuint id) noexcept
+		{
+			for (auto& buffer : buffers)
+				if (buffer == id) buffer = Unknown;
+			for (auto& buffer : uniformBuffers)
+				if (buffer.id == id) buffer.id = Unknown;
+		}
+
+		inline const Stats& GetStats() const noexcept
+		{
+			return stats;
+		}
+
+		inline void ResetStats() noexcept
+		{
+			stats = Stats();
+		}
+	protected:
+		/// <summary> Counts the call as elided if the state matches, issued calls are counted by the caller </summary>
+		inline const bool Elide(const bool same) noexcept
+		{
+			if (same) stats.elided++;
+			return same;
+		}
+
+		static inline StateCache*& CurrentPointer() noexcept
+		{
+			thread_local StateCache* current = nullptr;
+			return current;
+		}
+
+		static inline const uint8_t TextureSlotOf(const GLenum target) noexcept
+		{
+			switch (target)
+			{
+			case GL_TEXTURE_2D: return Slot_2D;
+			case GL_TEXTURE_2D_ARRAY: return Slot_2DArray;
+			case GL_TEXTURE_CUBE_MAP: return Slot_CubeMap;
+			default: return SLOT_MAX;
+			}
+		}
+
+		static inline const uint8_t BufferSlotOf(const GLenum target) noexcept
+		{
+			switch (target)
+			{
+			case GL_ARRAY_BUFFER: return Slot_Array;
+			case GL_ELEMENT_ARRAY_BUFFER: return Slot_ElementArray;
+			case GL_UNIFORM_BUFFER: return Slot_Uniform;
+			case GL_PIXEL_UNPACK_BUFFER: return Slot_PixelUnpack;
+			case GL_COPY_READ_BUFFER: return Slot_CopyRead;
+			case GL_COPY_WRITE_BUFFER: return Slot_CopyWrite;
+			default: return BUFFER_SLOT_MAX;
+			}
+		}
+	};
+}
@@ -0,0 +1,217 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "ScopedPtr.hpp"
+#include "StateCache.hpp"
+
+namespace gl
+{
+	/// <summary> Buffer for data rewritten every frame. The buffer is split into segments used round robin, one per frame.
+	/// With GL 4.4 / ARB_buffer_storage the storage is mapped once (persistent, coherent) and written directly; a fence
+	/// per segment keeps the CPU from overwriting data the GPU is still reading. Older contexts orphan the buffer each frame instead. </summary>
+	class StreamBuffer
+	{
+	public:
+		static constexpr uint8_t MaxSegments = 4;
+
+		struct Stats
+		{
+			size_t bytes = 0; //Bytes written
+			size_t frames = 0; //Calls of Advance
+			size_t stalls = 0; //Advances that had to wait for the GPU
+			std::chrono::nanoseconds stallTime = std::chrono::nanoseconds(0);
+		};
+	protected:
+		GLenum target;
+		GLuint id = 0;
+		uint8_t* mapped = nullptr; //Persistent mapping, nullptr when orphaning
+		ScopedPtr<uint8_t[]> shadow; //Copy of the current segment when orphaning, orphaned buffers can't be read back by Reserve
+		size_t segmentSize = 0;
+		size_t used = 0; //Bytes written to the current segment
+		uint8_t segments = 0, current = 0;
+		GLsync fences[MaxSegments] = {};
+		Stats stats;
+	public:
+		/// <summary> Creates the buffer </summary>
+		/// <param name="target"> Buffer target used for binding (GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, ...) </param>
+		/// <param name="segmentSize"> Bytes available per frame </param>
+		/// <param name="segments"> Frames in flight, 3 for triple buffering </param>
+		StreamBuffer(const GLenum target, const size_t segmentSize, const uint8_t segments = 3) : target(target)
+		{
+			Create(segmentSize, segments);
+		}
+
+		StreamBuffer(const StreamBuffer&) = delete;
+		StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+		~StreamBuffer()
+		{
+			Destroy();
+		}
+
+		/// <summary> Copies data into the current segment </summary>
+		/// <param name="offset"> Offset inside the segment </param>
+		/// <returns> False if the data doesn't fit in the segment </returns>
+		const bool Write(const void* data, const size_t offset, const size_t size) noexcept
+		{
+			if (offset + size > segmentSize) return false;
+			if (mapped) memcpy(mapped + current * segmentSize + offset, data, size);
+			else
+			{
+				Bind();
+				if (!used) glBufferData(target, segmentSize, nullptr, GL_STREAM_DRAW); //Orphan once per frame
+				glBufferSubData(target, offset, size, data);
+				memcpy(shadow.Get() + offset, data, size);
+			}
+			if (offset + size > used) used = offset + size;
+			stats.bytes += size;
+			return true;
+		}
+
+		/// <summary> Finishes the frame: fences the current segment and moves to the next one, waiting if the GPU still reads it </summary>
+		void Advance() noexcept
+		{
+			stats.frames++;
+			used = 0;
+			if (!mapped) return;
+
+			fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			current = (current + 1) % segments;
+			Wait(current);
+		}
+
+		/// <summary> Grows the segments, the written part of the current segment is kept. The old storage stays alive until the GPU is done with it. </summary>
+		void Reserve(const size_t size)
+		{
+			if (size <= segmentSize) return;
+			const size_t keep = used;
+			ScopedPtr<uint8_t[]> copy(keep ? new uint8_t[keep] : nullptr);
+			if (keep) memcpy(copy.Get(), mapped ? mapped + current * segmentSize : shadow.Get(), keep);
+			Destroy();
+			Create(size + size / 2, segments);
+			if (keep) Write(copy.Get(), 0, keep);
+		}
+
+		inline void Bind() const noexcept
+		{
+			StateCache::Current().BindBuffer(target, id);
+		}
+
+		/// <summary> Returns the offset of the current segment in the buffer, add it to the offsets of the attributes </summary>
+		inline const size_t GetSegmentOffset() const noexcept
+		{
+			return mapped ? current * segmentSize : 0;
+		}
+
+		inline const size_t GetSegmentSize() const noexcept
+		{
+			return segmentSize;
+		}
+
+		/// <summary> Returns true if the buffer is persistently mapped, false if it falls back to orphaning </summary>
+		inline const bool IsPersistent() const noexcept
+		{
+			return mapped != nullptr;
+		}
+
+		inline const GLuint& GetId() const noexcept
+		{
+			return id;
+		}
+
+		inline const Stats& GetStats() const noexcept
+		{
+			return stats;
+		}
+
+		inline void ResetStats() noexcept
+		{
+			stats = Stats();
+		}
+	protected:
+		void Create(const size_t size, const uint8_t count)
+		{
+			segmentSize = size;
+			segments = count < 1 ? 1 : (count > MaxSegments ? MaxSegments : count);
+			current = 0;
+			used = 0;
+			glGenBuffers(1, &id);
+			Bind();
+			if (GLEW_ARB_buffer_storage)
+			{
+				const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				glBufferStorage(target, segmentSize * segments, nullptr, flags);
+				mapped = static_cast<uint8_t*>(glMapBufferRange(target, 0, segmentSize * segments, flags));
+			}
+			if (!mapped)
+			{
+				segments = 1;
+				glBufferData(target, segmentSize, nullptr, GL_STREAM_DRAW);
+				shadow = new uint8_t[segmentSize];
+			}
+		}
+
+		void Destroy() noexcept
+		{
+			for (auto& fence : fences)
+			{
+				if (fence) glDeleteSync(fence);
+				fence = nullptr;
+			}
+			if (mapped)
+			{
+				Bind();
+				glUnmapBuffer(target);
+				mapped = nullptr;
+			}
+			shadow.Reset();
+			StateCache::Current().ForgetBuffer(id);
+			glDeleteBuffers(1, &id);
+		}
+
+		void Wait(const uint8_t segment) noexcept
+		{
+			GLsync& fence = fences[segment];
+			if (!fence) return;
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+			{
+				stats.stalls++;
+				const auto start = std::chrono::steady_clock::now();
+				do result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+				while (result == GL_TIMEOUT_EXPIRED);
+				stats.stallTime += std::chrono::steady_clock::now() - start;
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	};
+}
@@ -1,23 +1,29 @@
 #pragma once
 #include <GL/glew.h>
-#include <png.h>
 
 #include "Exception.hpp"
-#include "ScopedPtr.hpp"
+#include "Arena.hpp"
+#include "BlockCompression.hpp"
+#include "MappedFile.hpp"
+#include "MipmapGenerator.hpp"
+#include "PngReader.hpp"
+#include "TextureContainer.hpp"
+#include "StateCache.hpp"
 
 namespace gl
 {
 	class Texture
 	{
 	private:
-		GLuint id;
+		mutable GLuint id;
+		mutable bool immutable = false; //Allocated with glTexStorage2D, its size and format can't change
 	protected:
 		struct ImageDetails
 		{
 			unsigned int width = 0;
 			unsigned int height = 0;
 			bool alpha = false;
-			ScopedPtr<unsigned char> pixels;
+			unsigned char* pixels = nullptr; //In the scratch arena of the loading thread, reused by the next load
 		};
 	public:
 		Texture()
@@ -27,29 +33,50 @@ namespace gl
 
 		~Texture()
 		{
+			StateCache::Current().ForgetTexture(id);
 			glDeleteTextures(1, &id);
 		}
 
-		void Create(const GLuint width, const GLuint height, const GLenum colors, const void* pixels) const noexcept //GL_RGB GL_RGBA
+		/// <summary> Allocates the storage of every level and fills the first one, creating it again gives the texture a new id </summary>
+		/// <param name="colors"> GL_RED GL_RG GL_RGB GL_RGBA </param>
+		/// <param name="pixels"> Can be nullptr to fill it later with Update </param>
+		/// <param name="levels"> Number of mipmap levels, see GetLevelCount (Optional) </param>
+		void Create(const GLuint width, const GLuint height, const GLenum colors, const void* pixels, const GLint levels = 1) const noexcept
 		{
-			Bind(0);
+			const GLenum internal = colors == GL_RED ? GL_R8 : colors == GL_RG ? GL_RG8 : colors == GL_RGB ? GL_RGB8 : GL_RGBA8;
+			Allocate(internal, width, height, levels);
 			SetWrapping(GL_REPEAT);
-			SetFiltering(GL_LINEAR);
-			glTexImage2D(GL_TEXTURE_2D, 0, colors, width, height, 0, colors, GL_UNSIGNED_BYTE, pixels);
+			SetFiltering(levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR);
+			if (pixels) glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, colors, GL_UNSIGNED_BYTE, pixels);
 		}
 
-		void LoadFromFile(const std::string filename) const
+		/// <summary> Replaces a rectangle of the texture, pixels is an offset while a pixel unpack buffer is bound </summary>
+		void Update(const GLuint x, const GLuint y, const GLuint width, const GLuint height, const GLenum colors, const void* pixels, const GLint level = 0) const noexcept
+		{
+			BindForEdit();
+			glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, colors, GL_UNSIGNED_BYTE, pixels);
+		}
+
+		/// <summary> Loads a PNG, DDS or KTX2 file </summary>
+		/// <param name="mipmaps"> Builds the mip chain of PNG files on the CPU with gamma-correct filtering, containers bring their own levels (Optional) </param>
+		void LoadFromFile(const std::string filename, const bool mipmaps = false) const
 		{
 			size_t pos = filename.find_last_of('.');
 			if(pos == -1) throw Exception(Exception::File_NotFound, "File doesn't have an extension!");
 			pos++;
 			const std::string extension = filename.substr(pos, filename.size() - pos);
 
+			Arena::Scope scope(Arena::Scratch());
 			ImageDetails details;
 			try
 			{
 				if (extension == "png")
-					LoadPNG(filename, details);
+					LoadPNG(filename, details, mipmaps);
+				else if (extension == "dds" || extension == "ktx2")
+				{
+					LoadContainer(filename);
+					return;
+				}
 				/*else if (extension == "jpg" || extension == "jpeg")
 					LoadJPEG(filename, details);*/
 				else throw Exception(Exception::File_UnknownFormat, "File format " + extension + " not supported!");
@@ -59,36 +86,70 @@ namespace gl
 				throw e;
 			}
 
-			Bind(0);
 			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, details.width, details.height, 0,
-				details.alpha ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, (GLvoid *)details.pixels.ptr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			if (!mipmaps)
+			{
+				Create(details.width, details.height, details.alpha ? GL_RGBA : GL_RGB, details.pixels);
+				SetFiltering(GL_NEAREST);
+				return;
+			}
+			Create(details.width, details.height, GL_RGBA, details.pixels, GetLevelCount(details.width, details.height));
+			uint8_t* chain = Arena::Scratch().Allocate<uint8_t>(MipmapGenerator::GetChainSize(details.width, details.height));
+			MipmapGenerator::Generate(details.pixels, details.width, details.height, chain);
+			UpdateLevels(details.width, details.height, chain);
+		}
+
+		/// <summary> Uploads the levels after the first one, stored one after the other as MipmapGenerator::Generate writes them </summary>
+		void UpdateLevels(GLuint width, GLuint height, const void* chain) const noexcept
+		{
+			const unsigned char* pixels = static_cast<const unsigned char*>(chain);
+			for (GLint level = 1; width > 1 || height > 1; level++)
+			{
+				width = std::max(1u, width / 2);
+				height = std::max(1u, height / 2);
+				Update(0, 0, width, height, GL_RGBA, pixels, level);
+				pixels += (size_t)width * height * 4;
+			}
+		}
+
+		/// <summary> Returns the number of mipmap levels down to 1x1 </summary>
+		static inline const GLint GetLevelCount(const GLuint width, const GLuint height) noexcept
+		{
+			return MipmapGenerator::GetLevelCount(width, height);
 		}
 
 		void SetFiltering(const GLenum value) const noexcept //GL_LINEAR GL_NEAREST GL_NEAREST_MIPMAP_NEAREST GL_LINEAR_MIPMAP_NEAREST GL_NEAREST_MIPMAP_LINEAR GL_LINEAR_MIPMAP_LINEAR
 		{
+			BindForEdit();
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, value);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, value);
 		}
 
-		void SetWrapping(const GLenum value) const noexcept //GL_REPEAT GL_CLAMP_TO_EDGE GL_MIRRORED_REPEAT GL_CLAMP_TO_EDGE
+		/// <summary> Sets the minifying and magnifying filters separately, only the minifying filter can use mipmaps </summary>
+		void SetFiltering(const GLenum min, const GLenum mag) const noexcept
 		{
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, value);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, value);
+			BindForEdit();
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag);
 		}
 
+		void SetWrapping(const GLenum value) const noexcept //GL_REPEAT GL_CLAMP_TO_EDGE GL_MIRRORED_REPEAT GL_CLAMP_TO_BORDER
+		{
+			BindForEdit();
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, value);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, value);
+		}
 
 		void MakeMipmap() const noexcept
 		{
+			BindForEdit();
 			glGenerateMipmap(GL_TEXTURE_2D);
 		}
 
+		/// <summary> Binds the texture to a texture unit </summary>
 		inline void Bind(const GLuint index) const noexcept
 		{
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, id);
+			StateCache::Current().BindTexture(index, GL_TEXTURE_2D, id);
 		}
 
 		const GLuint& GetId() const noexcept
@@ -97,90 +158,83 @@ namespace gl
 		}
 
 	protected:
-		static void LoadPNG(const std::string& filename, ImageDetails& details)
+		inline void BindForEdit() const noexcept
 		{
-			FILE* f;
-			fopen_s(&f,filename.c_str(), "rb");
-			E_THROW_IF(!f,Exception::File_NotFound, "File " + filename + " could not be found!")
+			StateCache::Current().BindTextureForEdit(GL_TEXTURE_2D, id);
+		}
+
+		/// <summary> Allocates the levels with glTexStorage2D, or one by one without ARB_texture_storage, and binds the texture for editing </summary>
+		void Allocate(const GLenum internal, const GLsizei width, const GLsizei height, const GLint levels) const noexcept
+		{
+			if (immutable)
 			{
-				png_byte header[8];
-				fread(header, 1, 8, f);
-				std::cout << png_sig_cmp(header, 0, 8) << std::endl;
-				if (png_sig_cmp(header, 0, 8) != NULL) {
-					fclose(f);
-					throw Exception(Exception::File_Broken, "File header validation failed");
-				}
-			}
-			png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-			if (!png_ptr) {
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Failed to read file #1");
+				//Immutable storage can't be specified again, continue with a new texture
+				StateCache::Current().ForgetTexture(id);
+				glDeleteTextures(1, &id);
+				glGenTextures(1, &id);
+				immutable = false;
 			}
-			
-			png_infop info_ptr = png_create_info_struct(png_ptr);
-			if (!info_ptr) {
-				png_destroy_read_struct(&png_ptr, (png_infopp)NULL,
-					(png_infopp)NULL);
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Failed to read file #2");
+			BindForEdit();
+			if (GLEW_ARB_texture_storage)
+			{
+				glTexStorage2D(GL_TEXTURE_2D, levels, internal, width, height);
+				immutable = true;
 			}
+			else for (GLint i = 0; i < levels; i++)
+				glTexImage2D(GL_TEXTURE_2D, i, internal, std::max(1, width >> i), std::max(1, height >> i), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		}
 
-			png_infop end_info = png_create_info_struct(png_ptr);
-			if (!end_info) {
-				png_destroy_read_struct(&png_ptr, (png_infopp)NULL,
-					(png_infopp)NULL);
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Failed to read file #3");
-			}
-			if (setjmp(png_jmpbuf(png_ptr))) {
-				png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Failed to read file #4");
-			}
-			png_init_io(png_ptr, f);
-			png_set_sig_bytes(png_ptr, 8);
-			png_read_info(png_ptr, info_ptr);
-			png_uint_32 t_width, t_height;
-			int bit_depth, color_type;
-			png_get_IHDR(png_ptr, info_ptr, &t_width, &t_height, &bit_depth,&color_type, NULL, NULL, NULL);
-			details.width = t_width;
-			details.height = t_height;
-
-			png_read_update_info(png_ptr, info_ptr);
-			int row_bytes = png_get_rowbytes(png_ptr, info_ptr);
-			details.pixels=new unsigned char[row_bytes * t_height];
-			if (!details.pixels.ptr) {
-				png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Failed to read file #5");
-			}
-			png_bytepp row_pointers = new png_bytep[t_height];
-			if (!row_pointers) {
-				png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-				delete details.pixels.ptr;
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Failed to read file #6");
-			}
-			for (unsigned i = 0; i < t_height; ++i) {
-				row_pointers[t_height - 1 - i] = details.pixels.ptr + i * row_bytes;
-			}
-			png_read_image(png_ptr, row_pointers);
-			switch (png_get_color_type(png_ptr, info_ptr)) {
-			case PNG_COLOR_TYPE_RGBA:
-				details.alpha = true;
-				break;
-			case PNG_COLOR_TYPE_RGB:
-				details.alpha = false;
-				break;
-			default:
-				png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-				fclose(f);
-				throw Exception(Exception::File_Broken, "Color type #" + std::to_string(png_get_color_type(png_ptr, info_ptr)) + " not supported!");
+		/// <summary> Uploads every level of a DDS or KTX2 file straight from the mapped file. S3TC formats the context can't sample are decoded on the CPU. </summary>
+		void LoadContainer(const std::string& filename) const
+		{
+			MappedFile file(filename);
+			E_THROW_IF(!file.IsOpen(), Exception::File_NotFound, "File " + filename + " could not be found!")
+			const TextureContainer container(file.GetData(), file.GetSize());
+			const GLenum internal = container.GetFormat().internal;
+			const bool supported = TextureContainer::IsSupported(internal);
+			E_THROW_IF(!supported && !BlockCompression::IsS3TC(internal), Exception::File_UnknownFormat, "Texture format not supported by the GL context!")
+
+			const std::vector<TextureContainer::Level>& levels = container.GetLevels();
+			const bool compressed = supported && container.IsCompressed();
+			const bool srgb = internal == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || internal == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+				|| internal == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT || internal == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+			//Without ARB_texture_storage compressed levels are specified as they are uploaded
+			if (!compressed || GLEW_ARB_texture_storage)
+				Allocate(supported ? internal : srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, levels[0].width, levels[0].height, (GLint)levels.size());
+			else BindForEdit();
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (size_t i = 0; i < levels.size(); i++)
+			{
+				const TextureContainer::Level& level = levels[i];
+				if (compressed && immutable)
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, internal, (GLsizei)level.size, level.data);
+				else if (compressed)
+					glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internal, level.width, level.height, 0, (GLsizei)level.size, level.data);
+				else if (supported)
+					glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, level.data);
+				else
+				{
+					Arena::Scope scope(Arena::Scratch());
+					uint8_t* pixels = Arena::Scratch().Allocate<uint8_t>((size_t)level.width * level.height * 4);
+					BlockCompression::Decompress(internal, level.data, level.width, level.height, pixels);
+					glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+				}
 			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
 
-			png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-			delete row_pointers;
-			fclose(f);
+		static void LoadPNG(const std::string& filename, ImageDetails& details, const bool rgba)
+		{
+			PngReader reader(filename);
+			details.width = reader.GetWidth();
+			details.height = reader.GetHeight();
+			details.alpha = rgba || reader.HasAlpha();
+			const size_t stride = details.width * (details.alpha ? 4 : 3);
+			details.pixels = Arena::Scratch().Allocate<unsigned char>(stride * details.height);
+			reader.Read(details.pixels, stride, details.alpha);
 		}
 	};
 }
\ No newline at end of file
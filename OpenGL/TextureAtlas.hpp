@@ -0,0 +1,323 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Arena.hpp"
+#include "PngReader.hpp"
+#include "ScopedPtr.hpp"
+#include "StateCache.hpp"
+#include "Texture.hpp"
+
+namespace gl
+{
+	/// <summary> Packs rectangles into a fixed size bin with the skyline bottom-left heuristic </summary>
+	class SkylinePacker
+	{
+	protected:
+		struct Node
+		{
+			uint32_t x, y, width;
+		};
+		std::vector<Node> skyline; //Sorted by x, covers the whole width
+		uint32_t width, height;
+		size_t used = 0; //Area of the packed rectangles
+	public:
+		SkylinePacker(const uint32_t width, const uint32_t height) : width(width), height(height)
+		{
+			Clear();
+		}
+
+		/// <summary> Finds a place for a rectangle, the lowest top edge wins, then the leftmost </summary>
+		/// <returns> False if the rectangle doesn't fit </returns>
+		const bool Insert(const uint32_t w, const uint32_t h, uint32_t& x, uint32_t& y)
+		{
+			size_t best = skyline.size();
+			uint32_t bestTop = height + 1;
+			for (size_t i = 0; i < skyline.size(); i++)
+			{
+				uint32_t top;
+				if (Fit(i, w, h, top) && top < bestTop)
+				{
+					best = i;
+					bestTop = top;
+				}
+			}
+			if (best == skyline.size()) return false;
+			x = skyline[best].x;
+			y = bestTop - h;
+
+			//Raise the skyline under the rectangle
+			skyline.insert(skyline.begin() + best, { x, bestTop, w });
+			for (size_t i = best + 1; i < skyline.size();)
+			{
+				Node& node = skyline[i];
+				const uint32_t right = x + w;
+				if (node.x >= right) break;
+				const uint32_t cut = std::min(right - node.x, node.width);
+				node.x += cut;
+				node.width -= cut;
+				if (node.width == 0) skyline.erase(skyline.begin() + i);
+				else break;
+			}
+			for (size_t i = 0; i + 1 < skyline.size();)
+			{
+				if (skyline[i].y == skyline[i + 1].y)
+				{
+					skyline[i].width += skyline[i + 1].width;
+					skyline.erase(skyline.begin() + i + 1);
+				}
+				else i++;
+			}
+			used += (size_t)w * h;
+			return true;
+		}
+
+		void Clear()
+		{
+			skyline.assign(1, { 0, 0, width });
+			used = 0;
+		}
+
+		/// <summary> Returns the packed area divided by the area of the bin </summary>
+		inline const float GetOccupancy() const noexcept
+		{
+			return (float)used / ((float)width * height);
+		}
+	protected:
+		/// <summary> Checks if a rectangle fits with its left edge at node i </summary>
+		/// <param name="top"> Top edge of the rectangle resting on the skyline </param>
+		const bool Fit(size_t i, const uint32_t w, const uint32_t h, uint32_t& top) const noexcept
+		{
+			if (skyline[i].x + w > width) return false;
+			uint32_t bottom = 0;
+			for (uint32_t covered = 0; covered < w; i++)
+			{
+				bottom = std::max(bottom, skyline[i].y);
+				covered += skyline[i].width;
+			}
+			top = bottom + h;
+			return top <= height;
+		}
+	};
+
+	/// <summary> Packs images into square pages at runtime so sprites of different images can be drawn with one bind.
+	/// The pages are separate 2D textures (usable with SpriteBatch) or the layers of one GL_TEXTURE_2D_ARRAY.
+	/// Every image is surrounded by a copy of its edge pixels, so filtering and mipmaps don't bleed in from the neighbours. </summary>
+	class TextureAtlas
+	{
+	public:
+		enum Storage : uint8_t
+		{
+			Storage_Pages, //One Texture per page
+			Storage_Array //One layer of an array texture per page
+		};
+
+		/// <summary> Place of an image in the atlas </summary>
+		struct Region
+		{
+			glm::fvec4 uv; //x, y, width, height, as taken by SpriteBatch::Draw
+			const Texture* texture; //Page of the image, nullptr for Storage_Array
+			uint32_t layer; //Page index, the layer for Storage_Array
+			uint32_t x, y, width, height; //Pixels
+		};
+	protected:
+		const Storage storage;
+		const uint32_t size, padding, alignment, maxPages;
+		const GLint levels;
+		std::vector<SkylinePacker> packers;
+		std::vector<ScopedPtr<Texture>> pages; //Storage_Pages
+		GLuint array = 0; //Storage_Array
+		uint32_t layers = 0; //Allocated layers of the array
+		size_t pixels = 0; //Area of the images without padding
+		bool dirty = false; //Mipmaps are out of date
+	public:
+		/// <summary> Creates an empty atlas, pages are allocated when needed </summary>
+		/// <param name="size"> Width and height of a page </param>
+		/// <param name="padding"> Pixels of extruded edge around every image (Optional) </param>
+		/// <param name="levels"> Mip levels the images have to stay separate in, rectangles are aligned to 2^(levels-1) (Optional) </param>
+		/// <param name="maxPages"> Add fails once this many pages are full (Optional) </param>
+		TextureAtlas(const uint32_t size = 2048, const Storage storage = Storage_Pages, const uint32_t padding = 2, const GLint levels = 1, const uint32_t maxPages = 16)
+			: storage(storage), size(size), padding(padding), alignment(1u << (levels - 1)), maxPages(maxPages), levels(levels)
+		{ }
+
+		TextureAtlas(const TextureAtlas&) = delete;
+		TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+		~TextureAtlas()
+		{
+			if (array)
+			{
+				StateCache::Current().ForgetTexture(array);
+				glDeleteTextures(1, &array);
+			}
+		}
+
+		/// <summary> Adds an RGBA8 image, rows bottom-up like Texture </summary>
+		/// <param name="region"> Place of the image </param>
+		/// <returns> False if the image doesn't fit in a page or every page is full </returns>
+		const bool Add(const uint8_t* rgba, const uint32_t width, const uint32_t height, Region& region)
+		{
+			const uint32_t w = RoundUp(width + padding * 2), h = RoundUp(height + padding * 2);
+			if (w > size || h > size) return false;
+			uint32_t x = 0, y = 0, page = 0;
+			while (page < packers.size() && !packers[page].Insert(w, h, x, y)) page++;
+			if (page == packers.size())
+			{
+				if (page == maxPages) return false;
+				packers.emplace_back(size, size);
+				packers.back().Insert(w, h, x, y);
+				AddPage();
+			}
+
+			//Extrude the edges into the padding
+			Arena::Scope scope(Arena::Scratch());
+			uint32_t* padded = Arena::Scratch().Allocate<uint32_t>((size_t)w * h);
+			for (uint32_t py = 0; py < h; py++)
+			{
+				const uint32_t sy = (uint32_t)std::min<int64_t>(std::max<int64_t>((int64_t)py - padding, 0), height - 1);
+				for (uint32_t px = 0; px < w; px++)
+				{
+					const uint32_t sx = (uint32_t)std::min<int64_t>(std::max<int64_t>((int64_t)px - padding, 0), width - 1);
+					memcpy(&padded[py * w + px], rgba + ((size_t)sy * width + sx) * 4, 4);
+				}
+			}
+			if (storage == Storage_Pages) pages[page]->Update(x, y, w, h, GL_RGBA, padded);
+			else
+			{
+				StateCache::Current().BindTextureForEdit(GL_TEXTURE_2D_ARRAY, array);
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, page, w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE, padded);
+			}
+
+			region.x = x + padding;
+			region.y = y + padding;
+			region.width = width;
+			region.height = height;
+			region.layer = page;
+			region.texture = storage == Storage_Pages ? pages[page].Get() : nullptr;
+			region.uv = glm::fvec4((float)region.x / size, (float)region.y / size, (float)width / size, (float)height / size);
+			pixels += (size_t)width * height;
+			dirty = levels > 1;
+			return true;
+		}
+
+		/// <summary> Adds a PNG file </summary>
+		const bool AddFromFile(const std::string& filename, Region& region)
+		{
+			PngReader reader(filename);
+			Arena::Scope scope(Arena::Scratch());
+			uint8_t* rgba = Arena::Scratch().Allocate<uint8_t>((size_t)reader.GetWidth() * reader.GetHeight() * 4);
+			reader.Read(rgba, reader.GetWidth() * 4, true);
+			return Add(rgba, reader.GetWidth(), reader.GetHeight(), region);
+		}
+
+		/// <summary> Rebuilds the mipmaps of the pages if images were added since the last call </summary>
+		void MakeMipmaps() noexcept
+		{
+			if (!dirty) return;
+			if (storage == Storage_Pages)
+				for (const ScopedPtr<Texture>& page : pages) page->MakeMipmap();
+			else
+			{
+				StateCache::Current().BindTextureForEdit(GL_TEXTURE_2D_ARRAY, array);
+				glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			}
+			dirty = false;
+		}
+
+		/// <summary> Binds the array texture to a texture unit, Storage_Array only </summary>
+		inline void Bind(const GLuint unit) const noexcept
+		{
+			StateCache::Current().BindTexture(unit, GL_TEXTURE_2D_ARRAY, array);
+		}
+
+		/// <summary> Returns the area of the images without padding divided by the area of the pages </summary>
+		inline const float GetEfficiency() const noexcept
+		{
+			return packers.empty() ? 0.f : (float)pixels / ((float)size * size * packers.size());
+		}
+
+		inline const size_t GetPageCount() const noexcept
+		{
+			return packers.size();
+		}
+
+		/// <summary> Returns the page texture, Storage_Pages only </summary>
+		inline const Texture& GetPage(const size_t index) const noexcept
+		{
+			return *pages[index];
+		}
+
+		/// <summary> Returns the array texture, Storage_Array only </summary>
+		inline const GLuint& GetArrayId() const noexcept
+		{
+			return array;
+		}
+	protected:
+		inline const uint32_t RoundUp(const uint32_t value) const noexcept
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		void AddPage()
+		{
+			if (storage == Storage_Pages)
+			{
+				pages.emplace_back(new Texture());
+				pages.back()->Create(size, size, GL_RGBA, nullptr, levels);
+				return;
+			}
+			if (packers.size() <= layers) return;
+
+			//Arrays can't grow, copy the layers into a larger one. Without ARB_copy_image every page is allocated at once.
+			const uint32_t capacity = GLEW_ARB_copy_image ? std::min(std::max(layers * 2, 1u), maxPages) : maxPages;
+			GLuint grown;
+			glGenTextures(1, &grown);
+			StateCache::Current().BindTextureForEdit(GL_TEXTURE_2D_ARRAY, grown);
+			//Every level is allocated, copies need a complete texture
+			if (GLEW_ARB_texture_storage) glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, size, size, capacity);
+			else for (GLint level = 0; level < levels; level++)
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(size >> level, 1u), std::max(size >> level, 1u), capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+			if (array)
+			{
+				glCopyImageSubData(array, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, grown, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, layers);
+				StateCache::Current().ForgetTexture(array);
+				glDeleteTextures(1, &array);
+			}
+			array = grown;
+			layers = capacity;
+		}
+	};
+}
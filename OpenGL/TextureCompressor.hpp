@@ -0,0 +1,107 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.hpp"
+#include "MipmapGenerator.hpp"
+#include "PngReader.hpp"
+#include "TextureContainer.hpp"
+
+namespace gl
+{
+	/// <summary> Offline conversion of PNG files to block compressed DDS files with a full mip chain, loaded by Texture::LoadFromFile </summary>
+	class TextureCompressor
+	{
+	public:
+		struct Report
+		{
+			unsigned int width = 0, height = 0;
+			size_t levels = 0;
+			size_t rawBytes = 0; //RGBA8 size of every level
+			size_t compressedBytes = 0;
+			float rmse = 0.f; //Root mean square error of the first level per channel, 0-255
+		};
+
+		/// <summary> Converts a PNG to DDS </summary>
+		/// <param name="format"> DXT1, DXT3 or DXT5, 0 picks DXT5 for images with alpha and DXT1 for the rest (Optional) </param>
+		/// <param name="mipmaps"> Writes every level down to 1x1 (Optional) </param>
+		static Report Convert(const std::string& input, const std::string& output, GLenum format = 0, const bool mipmaps = true)
+		{
+			PngReader reader(input);
+			Report report;
+			report.width = reader.GetWidth();
+			report.height = reader.GetHeight();
+			if (!format) format = reader.HasAlpha() ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			E_THROW_IF(!BlockCompression::IsS3TC(format), Exception::File_UnknownFormat, "Only S3TC formats can be compressed!")
+
+			std::vector<uint8_t> image((size_t)report.width * report.height * 4), next;
+			reader.Read(image.data(), report.width * 4, true);
+			std::vector<std::vector<uint8_t>> blocks;
+			std::vector<TextureContainer::Level> levels;
+			GLsizei width = report.width, height = report.height;
+			while (true)
+			{
+				blocks.emplace_back(BlockCompression::GetSize(format, width, height));
+				BlockCompression::Compress(format, image.data(), width, height, blocks.back().data());
+				if (levels.empty()) report.rmse = Error(format, image.data(), width, height, blocks.back().data());
+				levels.push_back({ width, height, blocks.back().data(), blocks.back().size() });
+				report.rawBytes += image.size();
+				report.compressedBytes += blocks.back().size();
+				if (!mipmaps || (width == 1 && height == 1)) break;
+				next.resize((size_t)std::max(1, width / 2) * std::max(1, height / 2) * 4);
+				MipmapGenerator::Downsample(image.data(), width, height, next.data());
+				image.swap(next);
+				width = std::max(1, width / 2);
+				height = std::max(1, height / 2);
+			}
+			TextureContainer::WriteDDS(output, format, levels);
+			report.levels = levels.size();
+			return report;
+		}
+
+	protected:
+		static float Error(const GLenum format, const uint8_t* pixels, const size_t width, const size_t height, const uint8_t* blocks)
+		{
+			std::vector<uint8_t> decoded(width * height * 4);
+			BlockCompression::Decompress(format, blocks, width, height, decoded.data());
+			const size_t channels = BlockCompression::GetBlockBytes(format) == 8 ? 3 : 4;
+			double sum = 0.0;
+			for (size_t i = 0; i < width * height; i++)
+				for (size_t c = 0; c < channels; c++)
+				{
+					const double d = (double)pixels[i * 4 + c] - decoded[i * 4 + c];
+					sum += d * d;
+				}
+			return (float)std::sqrt(sum / (width * height * channels));
+		}
+	};
+}
@@ -0,0 +1,280 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Exception.hpp"
+
+namespace gl
+{
+	/// <summary> Reads the mip levels of DDS and KTX2 files without copying them, the data points into the memory given to Parse.
+	/// Levels are uploaded as stored: the first row is the bottom of the GL texture, like the output of TextureCompressor. </summary>
+	class TextureContainer
+	{
+	public:
+		static constexpr uint32_t MaxLevels = 32; //Dimensions are 32 bit, so deeper chains only repeat 1x1 levels
+
+		struct Format
+		{
+			GLenum internal; //Compressed format, or sized format for uncompressed data
+			uint32_t vkFormat; //KTX2
+			uint32_t dxgiFormat; //DDS DX10 header, 0 if not used
+			uint8_t blockWidth, blockHeight, blockBytes; //1x1 blocks of 4 bytes for uncompressed data
+		};
+
+		struct Level
+		{
+			GLsizei width, height;
+			const uint8_t* data;
+			size_t size;
+		};
+	protected:
+		const Format* format = nullptr;
+		std::vector<Level> levels;
+
+		static const Format* Formats(size_t& count) noexcept
+		{
+			static const Format formats[] =
+			{
+				{ GL_RGBA8, 37, 28, 1, 1, 4 }, { GL_SRGB8_ALPHA8, 43, 29, 1, 1, 4 },
+				{ GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 131, 0, 4, 4, 8 }, { GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 132, 0, 4, 4, 8 },
+				{ GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 133, 71, 4, 4, 8 }, { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 134, 72, 4, 4, 8 },
+				{ GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 135, 74, 4, 4, 16 }, { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 136, 75, 4, 4, 16 },
+				{ GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 137, 77, 4, 4, 16 }, { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 138, 78, 4, 4, 16 },
+				{ GL_COMPRESSED_RED_RGTC1, 139, 80, 4, 4, 8 }, { GL_COMPRESSED_SIGNED_RED_RGTC1, 140, 81, 4, 4, 8 },
+				{ GL_COMPRESSED_RG_RGTC2, 141, 83, 4, 4, 16 }, { GL_COMPRESSED_SIGNED_RG_RGTC2, 142, 84, 4, 4, 16 },
+				{ GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 143, 95, 4, 4, 16 }, { GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 144, 96, 4, 4, 16 },
+				{ GL_COMPRESSED_RGBA_BPTC_UNORM, 145, 98, 4, 4, 16 }, { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 146, 99, 4, 4, 16 },
+				{ GL_COMPRESSED_RGB8_ETC2, 147, 0, 4, 4, 8 }, { GL_COMPRESSED_SRGB8_ETC2, 148, 0, 4, 4, 8 },
+				{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 149, 0, 4, 4, 8 }, { GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 150, 0, 4, 4, 8 },
+				{ GL_COMPRESSED_RGBA8_ETC2_EAC, 151, 0, 4, 4, 16 }, { GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 152, 0, 4, 4, 16 },
+				{ GL_COMPRESSED_R11_EAC, 153, 0, 4, 4, 8 }, { GL_COMPRESSED_SIGNED_R11_EAC, 154, 0, 4, 4, 8 },
+				{ GL_COMPRESSED_RG11_EAC, 155, 0, 4, 4, 16 }, { GL_COMPRESSED_SIGNED_RG11_EAC, 156, 0, 4, 4, 16 },
+				{ GL_COMPRESSED_RGBA_ASTC_4x4_KHR, 157, 0, 4, 4, 16 }, { GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR, 158, 0, 4, 4, 16 },
+				{ GL_COMPRESSED_RGBA_ASTC_5x5_KHR, 161, 0, 5, 5, 16 }, { GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x5_KHR, 162, 0, 5, 5, 16 },
+				{ GL_COMPRESSED_RGBA_ASTC_6x6_KHR, 165, 0, 6, 6, 16 }, { GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6_KHR, 166, 0, 6, 6, 16 },
+				{ GL_COMPRESSED_RGBA_ASTC_8x8_KHR, 171, 0, 8, 8, 16 }, { GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR, 172, 0, 8, 8, 16 },
+			};
+			count = sizeof(formats) / sizeof(formats[0]);
+			return formats;
+		}
+	public:
+		/// <summary> Parses a DDS or KTX2 file </summary>
+		/// <param name="data"> Contents of the file, has to outlive the container </param>
+		TextureContainer(const uint8_t* data, const size_t size)
+		{
+			static const uint8_t ktx2[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+			if (size >= 12 && memcmp(data, ktx2, 12) == 0) ParseKTX2(data, size);
+			else if (size >= 4 && memcmp(data, "DDS ", 4) == 0) ParseDDS(data, size);
+			else throw Exception(Exception::File_UnknownFormat, "File is neither DDS nor KTX2!");
+		}
+
+		/// <summary> Returns the format of a GL internal format, nullptr if it's not in the table </summary>
+		static const Format* Find(const GLenum internal) noexcept
+		{
+			size_t count;
+			const Format* formats = Formats(count);
+			for (size_t i = 0; i < count; i++)
+				if (formats[i].internal == internal) return &formats[i];
+			return nullptr;
+		}
+
+		/// <summary> Returns true if the context can sample the format without a CPU decode </summary>
+		static const bool IsSupported(const GLenum internal) noexcept
+		{
+			switch (internal)
+			{
+			case GL_RGBA8: case GL_SRGB8_ALPHA8:
+			case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_SIGNED_RED_RGTC1:
+			case GL_COMPRESSED_RG_RGTC2: case GL_COMPRESSED_SIGNED_RG_RGTC2:
+				return true;
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+				return GLEW_EXT_texture_compression_s3tc;
+			case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT: case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+			case GL_COMPRESSED_RGBA_BPTC_UNORM: case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+				return GLEW_ARB_texture_compression_bptc;
+			}
+			const Format* format = Find(internal);
+			if (!format) return false;
+			if (format->vkFormat >= 147 && format->vkFormat <= 156) return GLEW_ARB_ES3_compatibility;
+			return GLEW_KHR_texture_compression_astc_ldr;
+		}
+
+		/// <summary> Writes a DDS file, with the DX10 header if the format has no FourCC </summary>
+		/// <param name="levels"> Mip levels from the largest, their data is written as is </param>
+		static void WriteDDS(const std::string& filename, const GLenum internal, const std::vector<Level>& levels)
+		{
+			const Format* format = Find(internal);
+			E_THROW_IF(!format || levels.empty(), Exception::File_UnknownFormat, "Format can't be written to DDS!")
+			uint32_t fourCC = 0;
+			switch (internal)
+			{
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: fourCC = FourCC("DXT1"); break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: fourCC = FourCC("DXT3"); break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: fourCC = FourCC("DXT5"); break;
+			default:
+				E_THROW_IF(!format->dxgiFormat, Exception::File_UnknownFormat, "Format can't be written to DDS!")
+				fourCC = FourCC("DX10");
+			}
+
+			uint32_t header[32] = {}; //Magic and DDS_HEADER
+			header[0] = FourCC("DDS ");
+			header[1] = 124;
+			header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; //Caps, height, width, pixel format, mip count, linear size
+			header[3] = levels[0].height;
+			header[4] = levels[0].width;
+			header[5] = (uint32_t)levels[0].size;
+			header[7] = (uint32_t)levels.size();
+			header[19] = 32;
+			header[20] = 0x4; //FourCC
+			header[21] = fourCC;
+			header[27] = 0x1000 | (levels.size() > 1 ? 0x400008 : 0); //Texture, mipmap and complex
+			std::ofstream file(filename, std::ios::binary);
+			E_THROW_IF(!file, Exception::File_NotFound, "File " + filename + " could not be created!")
+			file.write((const char*)header, sizeof(header));
+			if (fourCC == FourCC("DX10"))
+			{
+				const uint32_t dx10[5] = { format->dxgiFormat, 3, 0, 1, 0 }; //Format, 2D, flags, array size, alpha mode
+				file.write((const char*)dx10, sizeof(dx10));
+			}
+			for (const Level& level : levels) file.write((const char*)level.data, level.size);
+			E_THROW_IF(!file, Exception::File_Broken, "Failed to write " + filename)
+		}
+
+		/// <summary> Returns the size of a level in bytes </summary>
+		static const size_t GetLevelSize(const Format& format, const size_t width, const size_t height) noexcept
+		{
+			return ((width + format.blockWidth - 1) / format.blockWidth) * ((height + format.blockHeight - 1) / format.blockHeight) * format.blockBytes;
+		}
+
+		inline const Format& GetFormat() const noexcept
+		{
+			return *format;
+		}
+
+		inline const bool IsCompressed() const noexcept
+		{
+			return format->blockWidth > 1;
+		}
+
+		inline const std::vector<Level>& GetLevels() const noexcept
+		{
+			return levels;
+		}
+	protected:
+		static constexpr uint32_t FourCC(const char* code) noexcept
+		{
+			return (uint32_t)(uint8_t)code[0] | ((uint32_t)(uint8_t)code[1] << 8) | ((uint32_t)(uint8_t)code[2] << 16) | ((uint32_t)(uint8_t)code[3] << 24);
+		}
+
+		template <typename T>
+		static T Read(const uint8_t* data) noexcept
+		{
+			T value;
+			memcpy(&value, data, sizeof(T));
+			return value;
+		}
+
+		void ParseDDS(const uint8_t* data, const size_t size)
+		{
+			E_THROW_IF(size < 128, Exception::File_Broken, "DDS header is truncated!")
+			const uint32_t height = Read<uint32_t>(data + 12), width = Read<uint32_t>(data + 16);
+			const uint32_t mipCount = std::max(1u, Read<uint32_t>(data + 28));
+			const uint32_t pixelFlags = Read<uint32_t>(data + 80), fourCC = Read<uint32_t>(data + 84);
+			E_THROW_IF(mipCount > MaxLevels, Exception::File_Broken, "DDS has " + std::to_string(mipCount) + " mipmap levels!")
+			size_t offset = 128;
+			GLenum internal = 0;
+			if (pixelFlags & 0x4)
+			{
+				if (fourCC == FourCC("DXT1")) internal = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+				else if (fourCC == FourCC("DXT2") || fourCC == FourCC("DXT3")) internal = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+				else if (fourCC == FourCC("DXT4") || fourCC == FourCC("DXT5")) internal = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+				else if (fourCC == FourCC("ATI1") || fourCC == FourCC("BC4U")) internal = GL_COMPRESSED_RED_RGTC1;
+				else if (fourCC == FourCC("ATI2") || fourCC == FourCC("BC5U")) internal = GL_COMPRESSED_RG_RGTC2;
+				else if (fourCC == FourCC("DX10"))
+				{
+					E_THROW_IF(size < 148, Exception::File_Broken, "DDS header is truncated!")
+					const uint32_t dxgi = Read<uint32_t>(data + 128);
+					E_THROW_IF(Read<uint32_t>(data + 132) != 3 || Read<uint32_t>(data + 140) > 1, Exception::File_UnknownFormat, "Only 2D DDS textures are supported!")
+					offset = 148;
+					size_t count;
+					const Format* formats = Formats(count);
+					for (size_t i = 0; i < count && !internal; i++)
+						if (formats[i].dxgiFormat == dxgi) internal = formats[i].internal;
+				}
+			}
+			else if ((pixelFlags & 0x40) && Read<uint32_t>(data + 88) == 32 && Read<uint32_t>(data + 92) == 0xFF && Read<uint32_t>(data + 100) == 0xFF0000)
+				internal = GL_RGBA8; //Uncompressed RGBA in byte order
+			E_THROW_IF(!internal, Exception::File_UnknownFormat, "DDS pixel format not supported!")
+			format = Find(internal);
+			E_THROW_IF(Read<uint32_t>(data + 112) & 0x200, Exception::File_UnknownFormat, "DDS cube maps are not supported!")
+
+			for (uint32_t level = 0; level < mipCount; level++)
+			{
+				const GLsizei w = std::max(1u, width >> level), h = std::max(1u, height >> level);
+				const size_t bytes = GetLevelSize(*format, w, h);
+				E_THROW_IF(offset + bytes > size, Exception::File_Broken, "DDS level " + std::to_string(level) + " is truncated!")
+				levels.push_back({ w, h, data + offset, bytes });
+				offset += bytes;
+			}
+		}
+
+		void ParseKTX2(const uint8_t* data, const size_t size)
+		{
+			E_THROW_IF(size < 80, Exception::File_Broken, "KTX2 header is truncated!")
+			const uint32_t vkFormat = Read<uint32_t>(data + 12);
+			const uint32_t width = Read<uint32_t>(data + 20), height = Read<uint32_t>(data + 24);
+			const uint32_t depth = Read<uint32_t>(data + 28), layers = Read<uint32_t>(data + 32), faces = Read<uint32_t>(data + 36);
+			const uint32_t levelCount = std::max(1u, Read<uint32_t>(data + 40));
+			E_THROW_IF(depth > 0 || layers > 0 || faces != 1, Exception::File_UnknownFormat, "Only 2D KTX2 textures are supported!")
+			E_THROW_IF(Read<uint32_t>(data + 44) != 0, Exception::File_UnknownFormat, "Supercompressed KTX2 files are not supported!")
+			size_t count;
+			const Format* formats = Formats(count);
+			for (size_t i = 0; i < count && !format; i++)
+				if (formats[i].vkFormat == vkFormat) format = &formats[i];
+			E_THROW_IF(!format, Exception::File_UnknownFormat, "KTX2 format #" + std::to_string(vkFormat) + " not supported!")
+			E_THROW_IF(levelCount > MaxLevels, Exception::File_Broken, "KTX2 has " + std::to_string(levelCount) + " mipmap levels!")
+			E_THROW_IF(80 + size_t(levelCount) * 24 > size, Exception::File_Broken, "KTX2 level index is truncated!")
+
+			for (uint32_t level = 0; level < levelCount; level++)
+			{
+				const uint64_t offset = Read<uint64_t>(data + 80 + level * 24), bytes = Read<uint64_t>(data + 88 + level * 24);
+				const GLsizei w = std::max(1u, width >> level), h = std::max(1u, height >> level);
+				E_THROW_IF(offset > size || bytes > size - offset || bytes < GetLevelSize(*format, w, h), Exception::File_Broken, "KTX2 level " + std::to_string(level) + " is truncated!")
+				levels.push_back({ w, h, data + offset, (size_t)bytes });
+			}
+		}
+	};
+}
@@ -0,0 +1,392 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Arena.hpp"
+#include "MipmapGenerator.hpp"
+#include "PngReader.hpp"
+#include "ScopedPtr.hpp"
+#include "StateCache.hpp"
+#include "Texture.hpp"
+
+namespace gl
+{
+	/// <summary> Loads textures in the background: worker threads decode the files straight into a persistently mapped pixel unpack buffer,
+	/// Update uploads them from there on the GL thread with a limited number of bytes per frame. Without ARB_buffer_storage, or for images
+	/// larger than the staging buffer, the pixels are decoded to the heap and uploaded from there. Mip chains are built by the workers too. </summary>
+	class TextureLoader
+	{
+	public:
+		struct Stats
+		{
+			size_t loaded = 0; //Textures made resident
+			size_t failed = 0; //Files that couldn't be decoded
+			size_t bytes = 0; //Bytes uploaded
+			size_t uploads = 0; //glTexSubImage2D calls
+			size_t staged = 0; //Textures decoded into the staging buffer, the rest went through the heap
+			size_t waits = 0; //Times a worker waited for staging space
+		};
+	protected:
+		struct Job
+		{
+			Texture* texture;
+			std::string filename;
+			std::promise<void> promise;
+			std::exception_ptr error;
+			GLuint width = 0, height = 0;
+			bool mipmaps = false;
+			GLint levels = 1;
+			GLint level = 0; //Being uploaded
+			size_t levelOffset = 0; //Of the level being uploaded in the image
+			GLuint uploaded = 0; //Rows of the level uploaded
+			size_t offset = 0; //In the staging buffer
+			bool staged = false; //Decoded into the staging buffer
+			ScopedPtr<unsigned char[]> pixels; //Used when the staging buffer can't hold the image
+		};
+
+		//Allocation of the staging ring, released once the GPU read it
+		struct Region
+		{
+			size_t begin, end;
+			GLsync fence = nullptr;
+			bool released = false;
+		};
+
+		GLuint buffer = 0;
+		unsigned char* mapped = nullptr;
+		const size_t stagingSize;
+		size_t head = 0; //Next free byte of the ring
+		std::deque<Region> regions; //In allocation order, the first is the tail of the ring
+
+		size_t budget; //Bytes uploaded per Update
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake; //Jobs queued or stopping
+		std::condition_variable space; //Staging space released or stopping
+		std::deque<ScopedPtr<Job>> queued; //Waiting for a worker
+		std::deque<ScopedPtr<Job>> decoded; //Waiting for Update
+		std::atomic<size_t> pending{ 0 };
+		bool stopping = false;
+		Stats stats;
+	public:
+		/// <summary> Creates the loader on the GL thread </summary>
+		/// <param name="budget"> Bytes uploaded per Update, at least one row of a texture is uploaded (Optional) </param>
+		/// <param name="stagingSize"> Size of the pixel unpack buffer the workers decode into (Optional) </param>
+		/// <param name="threads"> Number of worker threads, 0 uses every hardware thread but one (Optional) </param>
+		TextureLoader(const size_t budget = 4 << 20, const size_t stagingSize = 32 << 20, const size_t threads = 0) : stagingSize(stagingSize), budget(budget)
+		{
+			if (GLEW_ARB_buffer_storage)
+			{
+				const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				glGenBuffers(1, &buffer);
+				StateCache::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+				glBufferStorage(GL_PIXEL_UNPACK_BUFFER, stagingSize, nullptr, flags);
+				mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stagingSize, flags));
+				StateCache::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
+			const size_t count = threads ? threads : std::max(2u, std::thread::hardware_concurrency()) - 1;
+			for (size_t i = 0; i < count; i++) workers.emplace_back(&TextureLoader::Work, this);
+		}
+
+		TextureLoader(const TextureLoader&) = delete;
+		TextureLoader& operator=(const TextureLoader&) = delete;
+
+		/// <summary> Stops the workers, textures not resident yet are abandoned and their futures report a broken promise </summary>
+		~TextureLoader()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			space.notify_all();
+			for (std::thread& worker : workers) worker.join();
+			for (Region& region : regions)
+				if (region.fence) glDeleteSync(region.fence);
+			if (buffer)
+			{
+				StateCache::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				StateCache::Current().ForgetBuffer(buffer);
+				glDeleteBuffers(1, &buffer);
+			}
+		}
+
+		/// <summary> Queues a file for loading, the texture has to stay alive until the future is ready </summary>
+		/// <param name="mipmaps"> Builds the mip chain on the worker with gamma-correct filtering and uploads it with the image (Optional) </param>
+		/// <returns> Ready once the texture is uploaded, or holds the Exception of a failed decode. Call Update while waiting on the GL thread. </returns>
+		std::future<void> Load(Texture& texture, const std::string& filename, const bool mipmaps = false)
+		{
+			ScopedPtr<Job> job(new Job);
+			job->texture = &texture;
+			job->filename = filename;
+			job->mipmaps = mipmaps;
+			std::future<void> future = job->promise.get_future();
+			pending++;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queued.push_back(std::move(job));
+			}
+			wake.notify_one();
+			return future;
+		}
+
+		/// <summary> Uploads decoded textures until the budget is used up and releases staging memory the GPU is done with. Call once per frame on the GL thread. </summary>
+		void Update()
+		{
+			Upload(budget);
+		}
+
+		/// <summary> Blocks until every queued texture is resident, for loading screens </summary>
+		void Flush()
+		{
+			while (pending)
+			{
+				Upload(~(size_t)0);
+				if (!pending) break;
+				std::unique_lock<std::mutex> lock(mutex);
+				space.wait_for(lock, std::chrono::milliseconds(1), [this] { return !decoded.empty(); });
+			}
+		}
+
+		/// <summary> Returns the number of textures queued and not resident yet </summary>
+		inline const size_t GetPending() const noexcept
+		{
+			return pending;
+		}
+
+		inline void SetBudget(const size_t bytes) noexcept
+		{
+			budget = bytes;
+		}
+
+		/// <summary> Returns true if the workers decode into a mapped pixel unpack buffer </summary>
+		inline const bool IsStaging() const noexcept
+		{
+			return mapped != nullptr;
+		}
+
+		inline const Stats& GetStats() const noexcept
+		{
+			return stats;
+		}
+
+		inline void ResetStats() noexcept
+		{
+			stats = Stats();
+		}
+	protected:
+		void Upload(size_t bytes)
+		{
+			Retire();
+			//Uploads from client memory after this would read from the staging buffer, so unbind it on every return
+			struct Unbind { ~Unbind() { StateCache::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); } } unbind;
+			while (true)
+			{
+				Job* job;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (decoded.empty()) return;
+					job = decoded.front().Get();
+				}
+				if (job->error)
+				{
+					if (job->staged) Release(job->offset);
+					job->promise.set_exception(job->error);
+					stats.failed++;
+					Finish();
+					continue;
+				}
+				if (!bytes) return;
+
+				const unsigned char* source = job->staged ? nullptr : job->pixels.Get();
+				if (job->level == 0 && job->uploaded == 0)
+				{
+					StateCache::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+					job->texture->Create(job->width, job->height, GL_RGBA, nullptr, job->levels);
+					if (job->levels == 1) job->texture->SetFiltering(GL_NEAREST);
+					if (job->staged) stats.staged++;
+				}
+				const GLuint width = std::max(1u, job->width >> job->level), height = std::max(1u, job->height >> job->level);
+				const size_t stride = width * 4;
+				//Rows of the level in this step, at least one so large textures still progress
+				const GLuint rows = (GLuint)std::min<size_t>(height - job->uploaded, std::max<size_t>(1, bytes / stride));
+				StateCache::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, source ? 0 : buffer);
+				const size_t at = job->levelOffset + job->uploaded * stride;
+				job->texture->Update(0, job->uploaded, width, rows, GL_RGBA, source ? (const void*)(source + at) : (const void*)(job->offset + at), job->level);
+				job->uploaded += rows;
+				bytes -= std::min(bytes, rows * stride);
+				stats.bytes += rows * stride;
+				stats.uploads++;
+				if (job->uploaded < height) return;
+				if (++job->level < job->levels)
+				{
+					job->levelOffset += stride * height;
+					job->uploaded = 0;
+					continue;
+				}
+
+				if (job->staged) Release(job->offset);
+				job->promise.set_value();
+				stats.loaded++;
+				Finish();
+			}
+		}
+
+		/// <summary> Drops the first decoded job </summary>
+		void Finish()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.pop_front();
+			pending--;
+		}
+
+		/// <summary> Fences the region at offset, its memory is reused once the GPU passed the fence </summary>
+		void Release(const size_t offset)
+		{
+			const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			std::lock_guard<std::mutex> lock(mutex);
+			for (Region& region : regions)
+				if (region.begin == offset && !region.released)
+				{
+					region.fence = fence;
+					region.released = true;
+					return;
+				}
+		}
+
+		/// <summary> Frees the regions at the tail of the ring whose fence passed </summary>
+		void Retire()
+		{
+			bool freed = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				while (!regions.empty() && regions.front().released)
+				{
+					if (glClientWaitSync(regions.front().fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+					glDeleteSync(regions.front().fence);
+					regions.pop_front();
+					freed = true;
+				}
+			}
+			if (freed) space.notify_all();
+		}
+
+		/// <summary> Allocates size bytes of the staging ring, waiting for the GL thread to release memory if needed </summary>
+		/// <returns> False if the memory can never fit or the loader is stopping </returns>
+		const bool Allocate(const size_t size, size_t& offset)
+		{
+			if (!mapped || size > stagingSize) return false;
+			std::unique_lock<std::mutex> lock(mutex);
+			bool waited = false;
+			while (!stopping)
+			{
+				offset = ~(size_t)0;
+				if (regions.empty()) offset = 0;
+				else if (regions.back().begin >= regions.front().begin)
+				{
+					//Not wrapped, free memory is [head, end) and [0, tail)
+					if (head + size <= stagingSize) offset = head;
+					else if (size <= regions.front().begin) offset = 0;
+				}
+				else if (head + size <= regions.front().begin) offset = head; //Wrapped, free memory is [head, tail)
+				if (offset != ~(size_t)0)
+				{
+					regions.push_back({ offset, offset + size });
+					head = offset + size;
+					if (waited) stats.waits++;
+					return true;
+				}
+				waited = true;
+				space.wait(lock);
+			}
+			return false;
+		}
+
+		void Work()
+		{
+			while (true)
+			{
+				ScopedPtr<Job> job;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [this] { return stopping || !queued.empty(); });
+					if (stopping) return;
+					job = std::move(queued.front());
+					queued.pop_front();
+				}
+				try
+				{
+					PngReader reader(job->filename);
+					job->width = reader.GetWidth();
+					job->height = reader.GetHeight();
+					const size_t image = (size_t)job->width * job->height * 4;
+					if (job->mipmaps) job->levels = MipmapGenerator::GetLevelCount(job->width, job->height);
+					const size_t size = image + (job->levels > 1 ? MipmapGenerator::GetChainSize(job->width, job->height) : 0);
+					unsigned char* pixels;
+					job->staged = Allocate(size, job->offset);
+					if (job->staged) pixels = mapped + job->offset;
+					else
+					{
+						job->pixels = new unsigned char[size];
+						pixels = job->pixels.Get();
+					}
+					if (job->levels > 1)
+					{
+						//The mapped memory can be write combined, the chain is built in cached memory and copied over
+						Arena::Scope scope(Arena::Scratch());
+						unsigned char* decoded = job->staged ? Arena::Scratch().Allocate<unsigned char>(size) : pixels;
+						reader.Read(decoded, job->width * 4, true);
+						MipmapGenerator::Generate(decoded, job->width, job->height, decoded + image);
+						if (decoded != pixels) memcpy(pixels, decoded, size);
+					}
+					else reader.Read(pixels, job->width * 4, true);
+				}
+				catch (...)
+				{
+					job->error = std::current_exception();
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					decoded.push_back(std::move(job));
+				}
+				space.notify_all();
+			}
+		}
+	};
+}
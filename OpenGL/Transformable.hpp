@@ -53,6 +53,16 @@ namespace gl
 			origin = value;
 		}
 
+		inline const glm::fmat4& GetMatrix() const noexcept
+		{
+			return matrix;
+		}
+
+		inline const float GetDepth() const noexcept
+		{
+			return depth;
+		}
+
 		inline void Update()
 		{
 			matrix = glm::translate(base, glm::vec3(position,depth));
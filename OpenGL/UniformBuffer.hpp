@@ -0,0 +1,309 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "StateCache.hpp"
+
+namespace gl
+{
+	/// <summary> std140 base alignment and size of a GLSL type. Matrices are stored as arrays of their columns. </summary>
+	template <typename T>
+	struct Std140
+	{
+		static_assert(sizeof(T) == 4, "Only 4 byte scalars (float, int, uint) are supported");
+		static constexpr size_t alignment = 4, size = 4, columns = 1;
+	};
+
+	template <glm::length_t L, typename T, glm::qualifier Q>
+	struct Std140<glm::vec<L, T, Q>>
+	{
+		static constexpr size_t alignment = (L == 3 ? 4 : L) * Std140<T>::size, size = L * Std140<T>::size, columns = 1;
+	};
+
+	template <glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+	struct Std140<glm::mat<C, R, T, Q>>
+	{
+		static constexpr size_t alignment = 16, size = C * 16, columns = C;
+	};
+
+	/// <summary> Layout of a uniform block, described member by member in std140 or taken from a linked program </summary>
+	class UniformLayout
+	{
+	public:
+		struct Field
+		{
+			std::string name;
+			size_t offset = 0;
+			size_t arrayStride = 0; //0 if not an array
+			size_t matrixStride = 0; //0 if not a matrix
+			size_t count = 1;
+		};
+	protected:
+		std::vector<Field> fields;
+		size_t size = 0;
+	public:
+		/// <summary> Appends a member with std140 rules, like it was declared in the block. Arrays and matrices are aligned to 16 bytes. </summary>
+		template <typename T>
+		UniformLayout& Add(const std::string_view name, const size_t count = 1)
+		{
+			const bool array = count > 1;
+			const size_t alignment = array || Std140<T>::columns > 1 ? RoundUp(Std140<T>::alignment, 16) : Std140<T>::alignment;
+			const size_t stride = array ? RoundUp(Std140<T>::size, 16) : Std140<T>::size;
+
+			Field field;
+			field.name = std::string(name);
+			field.offset = RoundUp(size, alignment);
+			field.arrayStride = array ? stride : 0;
+			field.matrixStride = Std140<T>::columns > 1 ? 16 : 0;
+			field.count = count;
+			size = field.offset + stride * count;
+			fields.push_back(std::move(field));
+			return *this;
+		}
+
+		/// <summary> Reads the layout of a block from a linked program. Member names are the ones GL reports, arrays without "[0]". </summary>
+		/// <returns> Empty layout if the program has no such block </returns>
+		static UniformLayout FromShader(const Shader& shader, const std::string_view block)
+		{
+			UniformLayout layout;
+			const GLuint program = shader.GetId();
+			const GLuint index = glGetUniformBlockIndex(program, std::string(block).c_str());
+			if (index == GL_INVALID_INDEX) return layout;
+
+			GLint size = 0, count = 0, maxLength = 0;
+			glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+			glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+			glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+			layout.size = size;
+
+			std::vector<GLint> indices(count), offsets(count), arrayStrides(count), matrixStrides(count), sizes(count);
+			glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+			const GLuint* members = reinterpret_cast<const GLuint*>(indices.data());
+			glGetActiveUniformsiv(program, count, members, GL_UNIFORM_OFFSET, offsets.data());
+			glGetActiveUniformsiv(program, count, members, GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+			glGetActiveUniformsiv(program, count, members, GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+			glGetActiveUniformsiv(program, count, members, GL_UNIFORM_SIZE, sizes.data());
+
+			std::string name(maxLength + 1, '\0');
+			for (GLint i = 0; i < count; i++)
+			{
+				GLsizei length = 0;
+				glGetActiveUniformName(program, members[i], maxLength + 1, &length, &name[0]);
+				std::string_view view(name.data(), length);
+				if (view.size() > 3 && view.substr(view.size() - 3) == "[0]") view.remove_suffix(3);
+
+				Field field;
+				field.name = std::string(view);
+				field.offset = offsets[i];
+				field.arrayStride = arrayStrides[i];
+				field.matrixStride = matrixStrides[i];
+				field.count = sizes[i];
+				layout.fields.push_back(std::move(field));
+			}
+			return layout;
+		}
+
+		/// <returns> Index of the member, -1 if not found </returns>
+		const int Find(const std::string_view name) const noexcept
+		{
+			for (size_t i = 0; i < fields.size(); i++)
+				if (fields[i].name == name) return (int)i;
+			return -1;
+		}
+
+		inline const Field& GetField(const size_t index) const noexcept
+		{
+			return fields[index];
+		}
+
+		inline const std::vector<Field>& GetFields() const noexcept
+		{
+			return fields;
+		}
+
+		/// <summary> Returns the size of the block in bytes, rounded up to 16 </summary>
+		inline const size_t GetSize() const noexcept
+		{
+			return RoundUp(size, 16);
+		}
+
+		static constexpr size_t RoundUp(const size_t value, const size_t alignment) noexcept
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	};
+
+	/// <summary> Uniform buffer object with a CPU side copy. Values are written to the copy and the changed byte range is uploaded with one call. </summary>
+	class UniformBuffer
+	{
+	protected:
+		GLuint id;
+		GLuint binding;
+		UniformLayout layout;
+		std::vector<uint8_t> staging;
+		size_t blockSize, stride, count;
+		size_t dirtyBegin, dirtyEnd;
+		size_t uploads = 0, uploadedBytes = 0;
+	public:
+		/// <summary> Creates the buffer </summary>
+		/// <param name="layout"> Layout of one block </param>
+		/// <param name="binding"> Binding point, see Shader::BindUniformBlock </param>
+		/// <param name="count"> Number of blocks stored after each other (e.g. one per object), selected with Bind </param>
+		UniformBuffer(const UniformLayout& layout, const GLuint binding, const size_t count = 1) : binding(binding), layout(layout), count(count)
+		{
+			GLint alignment = 256;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			blockSize = layout.GetSize();
+			stride = count > 1 ? UniformLayout::RoundUp(blockSize, alignment) : blockSize;
+			staging.assign(stride * count, 0);
+			dirtyBegin = staging.size();
+			dirtyEnd = 0;
+
+			glGenBuffers(1, &id);
+			StateCache::Current().BindBuffer(GL_UNIFORM_BUFFER, id);
+			glBufferData(GL_UNIFORM_BUFFER, staging.size(), staging.data(), GL_DYNAMIC_DRAW);
+		}
+
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+		~UniformBuffer()
+		{
+			StateCache::Current().ForgetBuffer(id);
+			glDeleteBuffers(1, &id);
+		}
+
+		/// <summary> Sets a member by name, does nothing if the layout doesn't have it </summary>
+		template <typename T>
+		inline void Set(const std::string_view name, const T& value, const size_t element = 0, const size_t block = 0)
+		{
+			const int field = layout.Find(name);
+			if (field != -1) Set(field, value, element, block);
+		}
+
+		/// <summary> Sets a member by its index in the layout (see UniformLayout::Find) </summary>
+		/// <param name="element"> Array element </param>
+		/// <param name="block"> Block index if the buffer holds more than one </param>
+		template <typename T>
+		void Set(const size_t field, const T& value, const size_t element = 0, const size_t block = 0)
+		{
+			const UniformLayout::Field& f = layout.GetField(field);
+			Write(block * stride + f.offset + element * f.arrayStride, value, f.matrixStride);
+		}
+
+		/// <summary> Copies raw bytes into a block </summary>
+		void SetData(const size_t offset, const void* data, const size_t size, const size_t block = 0)
+		{
+			Store(block * stride + offset, data, size);
+		}
+
+		/// <summary> Uploads the changed range of the CPU copy, one glBufferSubData call at most </summary>
+		void Upload()
+		{
+			if (dirtyBegin >= dirtyEnd) return;
+			StateCache::Current().BindBuffer(GL_UNIFORM_BUFFER, id);
+			glBufferSubData(GL_UNIFORM_BUFFER, dirtyBegin, dirtyEnd - dirtyBegin, staging.data() + dirtyBegin);
+			uploads++;
+			uploadedBytes += dirtyEnd - dirtyBegin;
+			dirtyBegin = staging.size();
+			dirtyEnd = 0;
+		}
+
+		/// <summary> Binds a block to the binding point of the buffer </summary>
+		inline void Bind(const size_t block = 0) const noexcept
+		{
+			if (count == 1) StateCache::Current().BindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+			else StateCache::Current().BindBufferRange(GL_UNIFORM_BUFFER, binding, id, block * stride, blockSize);
+		}
+
+		inline const bool IsDirty() const noexcept
+		{
+			return dirtyBegin < dirtyEnd;
+		}
+
+		inline const GLuint& GetId() const noexcept
+		{
+			return id;
+		}
+
+		inline const GLuint& GetBinding() const noexcept
+		{
+			return binding;
+		}
+
+		inline const UniformLayout& GetLayout() const noexcept
+		{
+			return layout;
+		}
+
+		inline const size_t GetBlockCount() const noexcept
+		{
+			return count;
+		}
+
+		/// <summary> Returns the number of glBufferSubData calls made so far </summary>
+		inline const size_t GetUploadCount() const noexcept
+		{
+			return uploads;
+		}
+
+		inline const size_t GetUploadedBytes() const noexcept
+		{
+			return uploadedBytes;
+		}
+	protected:
+		template <typename T>
+		inline void Write(const size_t offset, const T& value, const size_t)
+		{
+			Store(offset, &value, sizeof(T));
+		}
+
+		//Matrix columns are padded to the matrix stride
+		template <glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+		inline void Write(const size_t offset, const glm::mat<C, R, T, Q>& value, const size_t matrixStride)
+		{
+			const size_t columnStride = matrixStride ? matrixStride : 16;
+			for (glm::length_t c = 0; c < C; c++) Store(offset + c * columnStride, &value[c], sizeof(value[c]));
+		}
+
+		void Store(const size_t offset, const void* data, const size_t size)
+		{
+			if (offset + size > staging.size()) return;
+			if (memcmp(staging.data() + offset, data, size) == 0) return;
+			memcpy(staging.data() + offset, data, size);
+			if (offset < dirtyBegin) dirtyBegin = offset;
+			if (offset + size > dirtyEnd) dirtyEnd = offset + size;
+		}
+	};
+}
@@ -2,6 +2,15 @@
 
 #include <GL/glew.h>
 #include <initializer_list>
+#include <cstdint>
+#include <vector>
+
+#include "Arena.hpp"
+#include "InstanceBuffer.hpp"
+#include "ScopedPtr.hpp"
+#include "StateCache.hpp"
+#include "StreamBuffer.hpp"
+#include "VertexLayout.hpp"
 
 namespace gl
 {
@@ -11,55 +20,298 @@ namespace gl
 	{
 	private:
 		GLuint VBO, VAO;
+		GLuint EBO = 0; //Created by FillIndexBuffer
+		GLenum indexType = GL_UNSIGNED_SHORT;
+		size_t indexCount = 0;
 		size_t size;
+
+		struct Attrib
+		{
+			GLuint position;
+			GLint length;
+			GLenum type;
+			GLboolean normalized;
+			GLsizei stride;
+			size_t offset; //Bytes
+		};
+		mutable std::vector<Attrib> attribs; //Pointed again into the current segment when streaming
+		ScopedPtr<StreamBuffer> stream; //Replaces the VBO after EnableStreaming
+		mutable GLsizei vertexStride = 0; //Size of a vertex, set by the first attribute or the layout
+		GLsizei layoutStride = 0; //Stride of a layout bound with DSA to LayoutBinding
+
+		//Binding indices used by layouts with DSA, high enough not to collide with AddAttribPointer locations
+		static constexpr GLuint LayoutBinding = 14, InstanceBinding = 15;
 	public:
 		VertexArray_()
 		{
-			glGenBuffers(1, &this->VBO);
-			glGenVertexArrays(1, &this->VAO);
+			//Created objects (not just names) can be used with DSA before they are bound
+			if (GLEW_ARB_direct_state_access)
+			{
+				glCreateBuffers(1, &this->VBO);
+				glCreateVertexArrays(1, &this->VAO);
+			}
+			else
+			{
+				glGenBuffers(1, &this->VBO);
+				glGenVertexArrays(1, &this->VAO);
+			}
 		}
 		~VertexArray_()
 		{
+			StateCache::Current().ForgetVertexArray(VAO);
+			StateCache::Current().ForgetBuffer(VBO);
 			glDeleteVertexArrays(1, &VAO);
 			glDeleteBuffers(1, &VBO);
+			if (EBO)
+			{
+				StateCache::Current().ForgetBuffer(EBO);
+				glDeleteBuffers(1, &EBO);
+			}
 		}
 
 		void FillBuffer(const void* vertices, size_t size) noexcept
 		{
-			glBindVertexArray(this->VAO);
-
-			glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-			glBufferData(GL_ARRAY_BUFFER, size, vertices, D ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 			this->size = size;
+			if (stream)
+			{
+				stream->Reserve(size);
+				if (vertices) stream->Write(vertices, 0, size);
+				PointAttribs();
+				return;
+			}
+			StateCache::Current().BindVertexArray(this->VAO);
+			StateCache::Current().BindBuffer(GL_ARRAY_BUFFER, this->VBO);
+			glBufferData(GL_ARRAY_BUFFER, size, vertices, D ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 		}
 
 		inline void UpdateBuffer(const void* data, const size_t offset, const size_t size) noexcept
 		{
 			static_assert(D == true, "This method can only be used on a VertexArrayDynamic");
-			glBindVertexArray(this->VAO);
-			glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+			if (stream)
+			{
+				if (!stream->Write(data, offset, size))
+				{
+					stream->Reserve(offset + size);
+					stream->Write(data, offset, size);
+					PointAttribs();
+				}
+				return;
+			}
+			StateCache::Current().BindVertexArray(this->VAO);
+			StateCache::Current().BindBuffer(GL_ARRAY_BUFFER, this->VBO);
 			glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
 		}
 
+		/// <summary> Streams the vertices through a StreamBuffer: each frame writes a new segment, so updates never wait for draws of earlier frames. Call NextFrame after the draws of each frame. </summary>
+		/// <param name="segmentSize"> Bytes written per frame, grows when needed </param>
+		/// <param name="segments"> Frames in flight </param>
+		void EnableStreaming(const size_t segmentSize, const uint8_t segments = 3)
+		{
+			static_assert(D == true, "This method can only be used on a VertexArrayDynamic");
+			stream = new StreamBuffer(GL_ARRAY_BUFFER, segmentSize, segments);
+			PointAttribs();
+		}
+
+		/// <summary> Ends the frame of a streaming vertex array, the next updates go to the next segment </summary>
+		void NextFrame() noexcept
+		{
+			if (!stream) return;
+			stream->Advance();
+			PointAttribs();
+		}
+
+		/// <summary> Returns the statistics of the streaming buffer, nullptr if not streaming </summary>
+		inline const StreamBuffer* GetStream() const noexcept
+		{
+			return stream.Get();
+		}
+
+		/// <summary> Describes an attribute of the vertices in the buffer </summary>
+		/// <param name="shift"> Offset of the attribute in typeLen units </param>
+		/// <param name="stride"> Size of a whole vertex in bytes for interleaved buffers, 0 if the buffer holds only this attribute </param>
+		void AddAttribPointer(const GLuint position, const GLint length, const size_t shift,const GLenum type = GL_FLOAT,const size_t typeLen = sizeof(GLfloat), const GLsizei stride = 0, const GLboolean normalized = GL_FALSE) const noexcept
+		{
+			attribs.push_back({ position, length, type, normalized, stride ? stride : (GLsizei)(length * typeLen), shift * typeLen });
+			if (!vertexStride) vertexStride = attribs.back().stride;
+			StateCache::Current().BindVertexArray(VAO);
+			if (stream) stream->Bind();
+			else StateCache::Current().BindBuffer(GL_ARRAY_BUFFER, VBO);
+			const size_t base = stream ? stream->GetSegmentOffset() : 0;
+			glVertexAttribPointer(position, length, type, normalized, attribs.back().stride, (void*)(base + attribs.back().offset));
+			glEnableVertexAttribArray(position);
+		}
+
+		/// <summary> Sets up the attributes from a VertexLayout, with DSA if available </summary>
+		/// <template name="L"> VertexLayout of the vertices in the buffer </template>
+		template <typename L>
+		void SetLayout(const GLuint firstLocation = 0) noexcept
+		{
+			vertexStride = L::stride;
+			const GLuint buffer = stream ? stream->GetId() : VBO;
+			const size_t base = stream ? stream->GetSegmentOffset() : 0;
+			if (L::HasDSA())
+			{
+				layoutStride = L::stride;
+				L::Apply(VAO, buffer, firstLocation, LayoutBinding, base);
+				return;
+			}
+			L::ForEach([&](const GLuint location, const GLint components, const GLenum type, const GLboolean normalized, const size_t offset)
+			{
+				attribs.push_back({ location, components, type, normalized, L::stride, offset });
+			}, firstLocation);
+			L::Apply(VAO, buffer, firstLocation, 0, base);
+		}
+
+		/// <summary> Sets up per-instance attributes from a VertexLayout </summary>
+		template <typename L>
+		void SetInstanceLayout(const InstanceBuffer& buffer, const GLuint firstLocation) const noexcept
+		{
+			L::Apply(VAO, buffer.GetId(), firstLocation, InstanceBinding, 0, 1);
+		}
 
-		void AddAttribPointer(const GLuint position, const GLint length, const size_t shift,const GLenum type = GL_FLOAT,const size_t typeLen = sizeof(GLfloat)) const noexcept
+		/// <summary> Describes a per-instance attribute stored in an instance buffer </summary>
+		/// <param name="shift"> Offset of the attribute in typeLen units </param>
+		/// <param name="stride"> Size of a whole instance in bytes, 0 if the buffer holds only this attribute </param>
+		/// <param name="divisor"> Number of instances using the same value </param>
+		void AddInstanceAttrib(const InstanceBuffer& buffer, const GLuint position, const GLint length, const size_t shift, const GLenum type = GL_FLOAT, const size_t typeLen = sizeof(GLfloat), const GLsizei stride = 0, const GLboolean normalized = GL_FALSE, const GLuint divisor = 1) const noexcept
 		{
-			glVertexAttribPointer(position, length, type, GL_FALSE, length * typeLen, (void*)(shift * typeLen));
+			StateCache::Current().BindVertexArray(VAO);
+			buffer.Bind();
+			glVertexAttribPointer(position, length, type, normalized, stride ? stride : length * typeLen, (void*)(shift * typeLen));
 			glEnableVertexAttribArray(position);
+			glVertexAttribDivisor(position, divisor);
+		}
+
+		/// <summary> Describes a per-instance mat4 attribute, it takes the locations from position to position + 3 </summary>
+		/// <param name="offset"> Offset of the matrix in bytes </param>
+		/// <param name="stride"> Size of a whole instance in bytes, 0 if the buffer holds only matrices </param>
+		void AddInstanceMatrix(const InstanceBuffer& buffer, const GLuint position, const size_t offset = 0, const GLsizei stride = 0) const noexcept
+		{
+			for (GLuint column = 0; column < 4; column++)
+				AddInstanceAttrib(buffer, position + column, 4, offset + column * 4 * sizeof(GLfloat), GL_FLOAT, 1, stride ? stride : 16 * sizeof(GLfloat));
+		}
+
+		/// <summary> Fills the index buffer of the vertex array </summary>
+		/// <param name="size"> Size in bytes </param>
+		/// <param name="type"> GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT </param>
+		void FillIndexBuffer(const void* indices, const size_t size, const GLenum type = GL_UNSIGNED_SHORT) noexcept
+		{
+			if (!EBO)
+			{
+				if (GLEW_ARB_direct_state_access) glCreateBuffers(1, &EBO);
+				else glGenBuffers(1, &EBO);
+			}
+			StateCache::Current().BindVertexArray(this->VAO);
+			StateCache::Current().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, D ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+			indexType = type;
+			indexCount = size / IndexSize();
+		}
+
+		/// <summary> Fills the index buffer, stored as 16 bit if every index fits </summary>
+		void SetIndices(const uint32_t* indices, const size_t count)
+		{
+			uint32_t highest = 0;
+			for (size_t i = 0; i < count; i++) highest = indices[i] > highest ? indices[i] : highest;
+			if (highest > 0xFFFF)
+			{
+				FillIndexBuffer(indices, count * sizeof(uint32_t), GL_UNSIGNED_INT);
+				return;
+			}
+			Arena::Scope scope(Arena::Scratch());
+			uint16_t* shorts = Arena::Scratch().Allocate<uint16_t>(count);
+			for (size_t i = 0; i < count; i++) shorts[i] = (uint16_t)indices[i];
+			FillIndexBuffer(shorts, count * sizeof(uint16_t), GL_UNSIGNED_SHORT);
+		}
+
+		inline void SetIndices(const std::vector<uint32_t>& indices)
+		{
+			SetIndices(indices.data(), indices.size());
+		}
+
+		/// <summary> Returns GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, the type the index buffer is stored in </summary>
+		inline const GLenum& GetIndexType() const noexcept
+		{
+			return indexType;
+		}
+
+		inline const size_t& GetIndexCount() const noexcept
+		{
+			return indexCount;
+		}
+
+		/// <summary> Draws every index of the index buffer </summary>
+		inline void DrawElements(const GLenum mode) const noexcept
+		{
+			DrawElements(mode, 0, indexCount);
+		}
+
+		/// <summary> Draws a range of the index buffer </summary>
+		/// <param name="first"> First index (not byte offset) </param>
+		inline void DrawElements(const GLenum mode, const size_t first, const size_t count) const noexcept
+		{
+			StateCache::Current().BindVertexArray(VAO);
+			glDrawElements(mode, count, indexType, (const void*)(first * IndexSize()));
+		}
+
+		/// <summary> Draws a range of the index buffer with baseVertex added to every index, so several meshes can share the buffers with 16 bit indices </summary>
+		inline void DrawElementsBaseVertex(const GLenum mode, const size_t first, const size_t count, const GLint baseVertex) const noexcept
+		{
+			StateCache::Current().BindVertexArray(VAO);
+			glDrawElementsBaseVertex(mode, count, indexType, (const void*)(first * IndexSize()), baseVertex);
+		}
+
+		/// <summary> Draws instances of the whole index buffer </summary>
+		inline void DrawElementsInstanced(const GLenum mode, const size_t instances) const noexcept
+		{
+			DrawElementsInstanced(mode, indexCount, indexType, 0, instances);
+		}
+
+		inline void DrawArraysInstanced(const GLenum mode, const size_t first, const size_t count, const size_t instances) const noexcept
+		{
+			StateCache::Current().BindVertexArray(VAO);
+			glDrawArraysInstanced(mode, first, count, instances);
+		}
+
+		/// <summary> Draws instances using the index buffer </summary>
+		/// <param name="type"> GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT </param>
+		/// <param name="offset"> Offset of the first index in bytes </param>
+		inline void DrawElementsInstanced(const GLenum mode, const size_t count, const GLenum type, const size_t offset, const size_t instances) const noexcept
+		{
+			StateCache::Current().BindVertexArray(VAO);
+			glDrawElementsInstanced(mode, count, type, (const void*)offset, instances);
 		}
 
 		inline void DrawArray(GLenum mode, const size_t from, const size_t to) const noexcept
 		{
-			glBindVertexArray(VAO);
+			StateCache::Current().BindVertexArray(VAO);
 			glDrawArrays(mode, from, to);
 		}
 
+		/// <summary> Draws every vertex of the buffer </summary>
 		inline void DrawArray(GLenum mode) const noexcept
 		{
-			glBindVertexArray(VAO);
-			glDrawArrays(mode, 0, size);
+			StateCache::Current().BindVertexArray(VAO);
+			glDrawArrays(mode, 0, vertexStride ? size / vertexStride : size);
+		}
+
+	private:
+		inline const size_t IndexSize() const noexcept
+		{
+			return indexType == GL_UNSIGNED_INT ? 4 : (indexType == GL_UNSIGNED_SHORT ? 2 : 1);
 		}
 
+		/// <summary> Points the attributes into the current segment of the stream </summary>
+		void PointAttribs() const noexcept
+		{
+			const size_t base = stream->GetSegmentOffset();
+			if (layoutStride) glVertexArrayVertexBuffer(VAO, LayoutBinding, stream->GetId(), base, layoutStride);
+			if (attribs.empty()) return;
+			StateCache::Current().BindVertexArray(VAO);
+			stream->Bind();
+			for (const Attrib& a : attribs)
+				glVertexAttribPointer(a.position, a.length, a.type, a.normalized, a.stride, (void*)(base + a.offset));
+		}
 	};
 	typedef VertexArray_<false> VertexArray;
 	typedef VertexArray_<true> VertexArrayDynamic;
@@ -0,0 +1,213 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <GL/glew.h>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+#include "StateCache.hpp"
+
+namespace gl
+{
+	/// <summary> 16 bit float component (GL_HALF_FLOAT) </summary>
+	struct Half
+	{
+		uint16_t bits = 0;
+
+		Half() noexcept = default;
+
+		/// <summary> Converts with round to nearest even, overflow becomes infinity </summary>
+		Half(const float value) noexcept
+		{
+			uint32_t f;
+			memcpy(&f, &value, sizeof(f));
+			const uint32_t sign = (f >> 16) & 0x8000;
+			const uint32_t exponent = (f >> 23) & 0xFF;
+			uint32_t mantissa = f & 0x7FFFFF;
+			if (exponent == 0xFF) bits = (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0)); //Inf, NaN
+			else if (exponent > 142) bits = (uint16_t)(sign | 0x7C00); //Overflow
+			else if (exponent < 113) //Subnormal or zero
+			{
+				if (exponent < 102) { bits = (uint16_t)sign; return; }
+				mantissa |= 0x800000;
+				const uint32_t shift = 126 - exponent;
+				uint32_t half = mantissa >> shift;
+				const uint32_t rest = mantissa & ((1u << shift) - 1), middle = 1u << (shift - 1);
+				if (rest > middle || (rest == middle && (half & 1))) half++;
+				bits = (uint16_t)(sign | half);
+			}
+			else
+			{
+				uint32_t half = ((exponent - 112) << 10) | (mantissa >> 13);
+				const uint32_t rest = mantissa & 0x1FFF;
+				if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++; //May carry into the exponent, that's correct
+				bits = (uint16_t)(sign | half);
+			}
+		}
+	};
+
+	/// <summary> Four signed components packed in 10, 10, 10 and 2 bits (GL_INT_2_10_10_10_REV), e.g. normals with Attr&lt;Packed1010102, true&gt; </summary>
+	struct Packed1010102
+	{
+		uint32_t bits = 0;
+
+		Packed1010102() noexcept = default;
+
+		/// <summary> Packs components in the [-1, 1] range </summary>
+		Packed1010102(const glm::fvec4 value) noexcept
+		{
+			const auto pack = [](const float v, const float scale, const uint32_t mask)
+			{
+				const float clamped = v < -1.f ? -1.f : (v > 1.f ? 1.f : v);
+				return (uint32_t)(int32_t)std::lround(clamped * scale) & mask;
+			};
+			bits = pack(value.x, 511.f, 0x3FF) | (pack(value.y, 511.f, 0x3FF) << 10) | (pack(value.z, 511.f, 0x3FF) << 20) | (pack(value.w, 1.f, 0x3) << 30);
+		}
+	};
+
+	/// <summary> GL description of an attribute type: components, component type and number of locations taken </summary>
+	template <typename T>
+	struct AttribType;
+
+	template <> struct AttribType<GLfloat> { static constexpr GLint components = 1; static constexpr GLenum type = GL_FLOAT; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<GLint> { static constexpr GLint components = 1; static constexpr GLenum type = GL_INT; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<GLuint> { static constexpr GLint components = 1; static constexpr GLenum type = GL_UNSIGNED_INT; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<GLshort> { static constexpr GLint components = 1; static constexpr GLenum type = GL_SHORT; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<GLushort> { static constexpr GLint components = 1; static constexpr GLenum type = GL_UNSIGNED_SHORT; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<GLbyte> { static constexpr GLint components = 1; static constexpr GLenum type = GL_BYTE; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<GLubyte> { static constexpr GLint components = 1; static constexpr GLenum type = GL_UNSIGNED_BYTE; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<Half> { static constexpr GLint components = 1; static constexpr GLenum type = GL_HALF_FLOAT; static constexpr GLuint locations = 1; };
+	template <> struct AttribType<Packed1010102> { static constexpr GLint components = 4; static constexpr GLenum type = GL_INT_2_10_10_10_REV; static constexpr GLuint locations = 1; };
+
+	template <glm::length_t L, typename T, glm::qualifier Q>
+	struct AttribType<glm::vec<L, T, Q>>
+	{
+		static constexpr GLint components = L;
+		static constexpr GLenum type = AttribType<T>::type;
+		static constexpr GLuint locations = 1;
+	};
+
+	template <glm::length_t L, glm::qualifier Q>
+	struct AttribType<glm::vec<L, Half, Q>>
+	{
+		static constexpr GLint components = L;
+		static constexpr GLenum type = GL_HALF_FLOAT;
+		static constexpr GLuint locations = 1;
+	};
+
+	//Matrices take one location per column
+	template <glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+	struct AttribType<glm::mat<C, R, T, Q>>
+	{
+		static constexpr GLint components = R;
+		static constexpr GLenum type = AttribType<T>::type;
+		static constexpr GLuint locations = C;
+	};
+
+	/// <summary> Attribute of a VertexLayout </summary>
+	/// <template name="T"> C++ type of the attribute (float, glm vectors and matrices, Half, Packed1010102...) </template>
+	/// <template name="N"> True if integer components are normalized to [0, 1] or [-1, 1], otherwise they are converted to float as they are </template>
+	template <typename T, bool N = false>
+	struct Attr
+	{
+		typedef T Type;
+		static constexpr bool normalized = N;
+		static constexpr GLint components = AttribType<T>::components;
+		static constexpr GLenum type = AttribType<T>::type;
+		static constexpr GLuint locations = AttribType<T>::locations;
+		static constexpr size_t size = sizeof(T);
+	};
+
+	/// <summary> Vertex format with the offsets and the stride computed at compile time. Attributes are tightly packed in the given order and take consecutive locations. </summary>
+	template <typename... A>
+	struct VertexLayout
+	{
+		static constexpr size_t count = sizeof...(A);
+		static constexpr GLsizei stride = (GLsizei)(0 + ... + A::size);
+		static constexpr std::array<size_t, count> offsets = []()
+		{
+			std::array<size_t, count> result = {};
+			const size_t sizes[] = { A::size... };
+			for (size_t i = 1; i < count; i++) result[i] = result[i - 1] + sizes[i - 1];
+			return result;
+		}();
+		static constexpr GLuint locations = (0 + ... + A::locations);
+
+		/// <summary> Calls f(location, components, type, normalized, offset) for every location of the layout </summary>
+		template <typename F>
+		static void ForEach(F f, const GLuint firstLocation = 0)
+		{
+			GLuint location = firstLocation;
+			size_t i = 0;
+			(Visit<A>(f, location, offsets[i++]), ...);
+		}
+
+		/// <summary> Sets up the attributes of a vertex array, with DSA if available </summary>
+		/// <param name="binding"> Vertex buffer binding index used with DSA </param>
+		/// <param name="offset"> Offset of the first vertex in the buffer </param>
+		/// <param name="divisor"> 0 for per-vertex, 1 for per-instance data </param>
+		static void Apply(const GLuint vertexArray, const GLuint buffer, const GLuint firstLocation = 0, const GLuint binding = 0, const size_t offset = 0, const GLuint divisor = 0) noexcept
+		{
+			if (HasDSA())
+			{
+				glVertexArrayVertexBuffer(vertexArray, binding, buffer, offset, stride);
+				glVertexArrayBindingDivisor(vertexArray, binding, divisor);
+				ForEach([&](const GLuint location, const GLint components, const GLenum type, const GLboolean normalized, const size_t relative)
+				{
+					glEnableVertexArrayAttrib(vertexArray, location);
+					glVertexArrayAttribFormat(vertexArray, location, components, type, normalized, relative);
+					glVertexArrayAttribBinding(vertexArray, location, binding);
+				}, firstLocation);
+			}
+			else
+			{
+				StateCache::Current().BindVertexArray(vertexArray);
+				StateCache::Current().BindBuffer(GL_ARRAY_BUFFER, buffer);
+				ForEach([&](const GLuint location, const GLint components, const GLenum type, const GLboolean normalized, const size_t relative)
+				{
+					glEnableVertexAttribArray(location);
+					glVertexAttribPointer(location, components, type, normalized, stride, (const void*)(offset + relative));
+					glVertexAttribDivisor(location, divisor);
+				}, firstLocation);
+			}
+		}
+
+		static inline const bool HasDSA() noexcept
+		{
+			return GLEW_ARB_direct_state_access;
+		}
+	protected:
+		template <typename T, typename F>
+		static void Visit(F& f, GLuint& location, const size_t offset)
+		{
+			for (GLuint l = 0; l < T::locations; l++, location++)
+				f(location, T::components, T::type, (GLboolean)T::normalized, offset + l * T::size / T::locations);
+		}
+	};
+}
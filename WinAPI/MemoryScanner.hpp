@@ -0,0 +1,399 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ProcessMemory.hpp"
+
+/// <summary> Searches the memory of a process for values and byte patterns using multiple threads. </summary>
+class MemoryScanner
+{
+public:
+	/// <summary> Selects which regions are scanned. </summary>
+	enum RegionFilter : uint8_t
+	{
+		Region_All = 0,
+		Region_Writable = 1,
+		Region_Executable = 2
+	};
+protected:
+	const ProcessMemory& process;
+	size_t threads; //Number of worker threads
+	size_t chunkSize; //Bytes read by one call
+	uint8_t filter = Region_All;
+	uint64_t lastBytes = 0; //Bytes read by the last scan
+	double lastSeconds = 0.0; //Duration of the last scan
+
+	/// <summary> Byte pattern with a mask, a zero mask byte matches any byte </summary>
+	struct Pattern
+	{
+		std::vector<uint8_t> bytes;
+		std::vector<uint8_t> mask;
+		size_t alignment = 1;
+	};
+public:
+	/// <summary> Creates a scanner </summary>
+	/// <param name="process"> Process to scan </param>
+	/// <param name="threads"> Number of worker threads, 0 uses every hardware thread (Optional) </param>
+	/// <param name="chunkSize"> Bytes read by one call (Optional) </param>
+	MemoryScanner(const ProcessMemory& process, const size_t threads = 0, const size_t chunkSize = 4 << 20)
+		: process(process), threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())), chunkSize(chunkSize)
+	{ }
+
+	/// <summary> Restricts the scan to some regions (Region_Writable | Region_Executable) </summary>
+	inline void SetRegionFilter(const uint8_t value) noexcept
+	{
+		filter = value;
+	}
+
+	/// <summary> Finds every occurrence of a value. </summary>
+	/// <param name="value"> Value to search for </param>
+	/// <param name="alignment"> Alignment of the reported addresses, 0 is treated as 1 (Optional) </param>
+	/// <returns> Sorted list of addresses </returns>
+	template <typename T>
+	std::vector<uint64_t> FindValue(const T value, const size_t alignment = alignof(T))
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "[class MemoryScanner] Value must be trivially copyable");
+		Pattern pattern;
+		pattern.bytes.resize(sizeof(T));
+		memcpy(pattern.bytes.data(), &value, sizeof(T));
+		pattern.mask.assign(sizeof(T), 0xFF);
+		pattern.alignment = std::max<size_t>(1, alignment);
+
+		//Whole lanes can be compared at once if the values are naturally aligned
+		if ((sizeof(T) == 4 || sizeof(T) == 8) && pattern.alignment % sizeof(T) == 0)
+		{
+			return Scan(sizeof(T), [&pattern](const uint8_t* data, const size_t size, const size_t limit, const uint64_t address, std::vector<uint64_t>& out)
+			{
+				FindLanes<sizeof(T)>(pattern, data, size, limit, address, out);
+			});
+		}
+		return FindPattern(pattern);
+	}
+
+	/// <summary> Finds every value between min and max (inclusive). </summary>
+	/// <param name="min"> Lower bound </param>
+	/// <param name="max"> Upper bound </param>
+	/// <param name="alignment"> Alignment of the reported addresses, 0 is treated as 1 (Optional) </param>
+	/// <returns> Sorted list of addresses </returns>
+	template <typename T>
+	std::vector<uint64_t> FindRange(const T min, const T max, const size_t alignment = alignof(T))
+	{
+		static_assert(std::is_arithmetic<T>::value, "[class MemoryScanner] Range search needs an arithmetic type");
+		const size_t step = std::max<size_t>(1, alignment);
+		return Scan(sizeof(T), [min, max, step](const uint8_t* data, const size_t size, const size_t limit, const uint64_t address, std::vector<uint64_t>& out)
+		{
+			const size_t end = std::min(limit, size < sizeof(T) ? 0 : size - sizeof(T) + 1);
+			for (size_t i = 0; i < end; i += step)
+			{
+				T value;
+				memcpy(&value, data + i, sizeof(T));
+				if (value >= min && value <= max) out.push_back(address + i);
+			}
+		});
+	}
+
+	/// <summary> Finds every occurrence of a signature like "48 8B 05 ?? ?? ?? ??". </summary>
+	/// <param name="signature"> Hexadecimal bytes separated by spaces, ? or ?? is a wildcard. Throws std::invalid_argument for any other token. </param>
+	/// <param name="alignment"> Alignment of the reported addresses, 0 is treated as 1 (Optional) </param>
+	/// <returns> Sorted list of addresses </returns>
+	std::vector<uint64_t> FindPattern(const std::string& signature, const size_t alignment = 1)
+	{
+		Pattern pattern;
+		pattern.alignment = std::max<size_t>(1, alignment);
+		for (size_t i = 0; i < signature.size();)
+		{
+			if (std::isspace((unsigned char)signature[i])) { i++; continue; }
+			size_t end = i;
+			while (end < signature.size() && !std::isspace((unsigned char)signature[end])) end++;
+			const std::string token = signature.substr(i, end - i);
+			const bool wildcard = token == "?" || token == "??";
+			if (!wildcard && (token.size() > 2 || !std::isxdigit((unsigned char)token[0]) || !std::isxdigit((unsigned char)token.back())))
+				throw std::invalid_argument("[class MemoryScanner] Invalid signature token \"" + token + "\"");
+			pattern.bytes.push_back(wildcard ? 0 : (uint8_t)std::strtoul(token.c_str(), nullptr, 16));
+			pattern.mask.push_back(wildcard ? 0 : 0xFF);
+			i = end;
+		}
+		return FindPattern(pattern);
+	}
+
+	/// <summary> Finds every occurrence of a masked byte pattern. </summary>
+	/// <param name="bytes"> Bytes to search for </param>
+	/// <param name="mask"> Mask of the bytes, only the set bits are compared </param>
+	/// <param name="length"> Length of the pattern </param>
+	/// <param name="alignment"> Alignment of the reported addresses, 0 is treated as 1 (Optional) </param>
+	/// <returns> Sorted list of addresses </returns>
+	std::vector<uint64_t> FindPattern(const uint8_t* bytes, const uint8_t* mask, const size_t length, const size_t alignment = 1)
+	{
+		Pattern pattern;
+		pattern.bytes.assign(bytes, bytes + length);
+		pattern.mask.assign(mask, mask + length);
+		pattern.alignment = std::max<size_t>(1, alignment);
+		return FindPattern(pattern);
+	}
+
+	/// <summary> Returns the read throughput of the last scan </summary>
+	/// <returns> Throughput in GB/s </returns>
+	inline const double GetLastThroughput() const noexcept
+	{
+		return lastSeconds > 0.0 ? lastBytes / lastSeconds / 1e9 : 0.0;
+	}
+
+	/// <summary> Returns the number of bytes read by the last scan </summary>
+	inline const uint64_t GetLastScannedBytes() const noexcept
+	{
+		return lastBytes;
+	}
+protected:
+	std::vector<uint64_t> FindPattern(const Pattern& pattern)
+	{
+		if (pattern.bytes.empty()) return {};
+		return Scan(pattern.bytes.size(), [&pattern](const uint8_t* data, const size_t size, const size_t limit, const uint64_t address, std::vector<uint64_t>& out)
+		{
+			FindMasked(pattern, data, size, limit, address, out);
+		});
+	}
+
+	/// <summary> Runs a search kernel on every chunk in parallel and merges the matches. </summary>
+	/// <param name="length"> Length of a match, consecutive chunks overlap by length - 1 bytes </param>
+	/// <param name="kernel"> Called with (data, size, limit, address, output), only matches starting before limit are reported </param>
+	/// <returns> Sorted list of addresses </returns>
+	template <typename K>
+	std::vector<uint64_t> Scan(const size_t length, K kernel)
+	{
+		std::vector<std::vector<uint64_t>> results(threads);
+		ScanChunks(length, [&](const uint8_t* data, const size_t size, const size_t limit, const uint64_t address, const size_t thread)
+		{
+			kernel(data, size, limit, address, results[thread]);
+		});
+
+		//Merge the results of the workers
+		std::vector<uint64_t> result;
+		for (auto& r : results) result.insert(result.end(), r.begin(), r.end());
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	/// <summary> Reads the selected regions in chunks and runs the kernel on each chunk in parallel. </summary>
+	/// <param name="length"> Length of a match, consecutive chunks overlap by length - 1 bytes </param>
+	/// <param name="kernel"> Called with (data, size, limit, address, thread index) </param>
+	template <typename K>
+	void ScanChunks(const size_t length, K kernel)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		//Split the regions into chunks
+		struct Chunk
+		{
+			uint64_t address;
+			size_t limit; //Bytes owned by the chunk
+			size_t size; //Bytes read, including the overlap
+		};
+		std::vector<Chunk> chunks;
+		for (const auto& region : process.GetRegions())
+		{
+			if ((filter & Region_Writable) && !region.writable) continue;
+			if ((filter & Region_Executable) && !region.executable) continue;
+			const uint64_t end = region.base + region.size;
+			for (uint64_t address = region.base; address < end; address += chunkSize)
+			{
+				const size_t limit = (size_t)std::min<uint64_t>(chunkSize, end - address);
+				chunks.push_back({ address, limit, (size_t)std::min<uint64_t>(limit + length - 1, end - address) });
+			}
+		}
+
+		//Each worker takes the next chunk until none are left
+		std::atomic<size_t> next(0);
+		std::atomic<uint64_t> bytes(0);
+		auto worker = [&](const size_t index)
+		{
+			std::vector<uint8_t> buffer(chunkSize + length);
+			for (size_t i = next++; i < chunks.size(); i = next++)
+			{
+				const Chunk& chunk = chunks[i];
+				if (process.ReadMemory(chunk.address, buffer.data(), chunk.size))
+				{
+					kernel(buffer.data(), chunk.size, chunk.limit, chunk.address, index);
+					bytes += chunk.size;
+					continue;
+				}
+				//Part of the chunk is unreadable, scan the readable pages on their own. Each page is read with the
+				//overlap so matches crossing into the next page are kept, unless the next page is the unreadable one.
+				const size_t page = 4096;
+				for (size_t offset = 0; offset < chunk.limit; offset += page)
+				{
+					const size_t limit = std::min(page, chunk.limit - offset);
+					size_t size = std::min(page + length - 1, chunk.size - offset);
+					if (!process.ReadMemory(chunk.address + offset, buffer.data(), size))
+					{
+						size = limit;
+						if (!process.ReadMemory(chunk.address + offset, buffer.data(), size)) continue;
+					}
+					kernel(buffer.data(), size, limit, chunk.address + offset, index);
+					bytes += size;
+				}
+			}
+		};
+		std::vector<std::thread> pool;
+		for (size_t i = 1; i < threads; i++) pool.emplace_back(worker, i);
+		worker(0);
+		for (auto& t : pool) t.join();
+
+		lastBytes = bytes;
+		lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary> Index of the lowest set bit. </summary>
+	static inline const uint32_t LowestBit(const uint32_t value) noexcept
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return index;
+#else
+		return __builtin_ctz(value);
+#endif
+	}
+
+#if defined(__SSE2__) || defined(_M_X64)
+	/// <summary> Compares 4 or 8 byte lanes, 8 byte lanes are emulated without SSE4.1. </summary>
+	template <size_t S>
+	static inline __m128i CompareLanes(const __m128i a, const __m128i b) noexcept
+	{
+		if (S == 4) return _mm_cmpeq_epi32(a, b);
+#ifdef __SSE4_1__
+		return _mm_cmpeq_epi64(a, b);
+#else
+		const __m128i halves = _mm_cmpeq_epi32(a, b);
+		return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+	}
+#endif
+
+	/// <summary> Compares whole 4 or 8 byte lanes against an exact value. </summary>
+	template <size_t S>
+	static void FindLanes(const Pattern& pattern, const uint8_t* data, const size_t size, const size_t limit, const uint64_t address, std::vector<uint64_t>& out)
+	{
+		const size_t end = std::min(limit, size < S ? 0 : size - S + 1);
+		const uint32_t lane = (1u << S) - 1; //Movemask bits of one lane
+		size_t i = 0;
+#if defined(__AVX2__)
+		const __m256i needle = S == 4 ? _mm256_set1_epi32(*(const int32_t*)pattern.bytes.data()) : _mm256_set1_epi64x(*(const int64_t*)pattern.bytes.data());
+		for (; i + 32 <= end; i += 32)
+		{
+			const __m256i block = _mm256_loadu_si256((const __m256i*)(data + i));
+			uint32_t bits = (uint32_t)_mm256_movemask_epi8(S == 4 ? _mm256_cmpeq_epi32(block, needle) : _mm256_cmpeq_epi64(block, needle));
+			while (bits)
+			{
+				const uint32_t bit = LowestBit(bits);
+				if ((i + bit) % pattern.alignment == 0) out.push_back(address + i + bit);
+				bits &= ~(lane << bit);
+			}
+		}
+#elif defined(__SSE2__) || defined(_M_X64)
+		const __m128i needle = S == 4 ? _mm_set1_epi32(*(const int32_t*)pattern.bytes.data()) : _mm_set1_epi64x(*(const int64_t*)pattern.bytes.data());
+		for (; i + 16 <= end; i += 16)
+		{
+			const __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+			uint32_t bits = (uint32_t)_mm_movemask_epi8(CompareLanes<S>(block, needle));
+			while (bits)
+			{
+				const uint32_t bit = LowestBit(bits);
+				if ((i + bit) % pattern.alignment == 0) out.push_back(address + i + bit);
+				bits &= ~(lane << bit);
+			}
+		}
+#endif
+		for (; i < end; i += S)
+			if (i % pattern.alignment == 0 && memcmp(data + i, pattern.bytes.data(), S) == 0) out.push_back(address + i);
+	}
+
+	/// <summary> Searches for a masked pattern by locating its first fully masked byte, then verifying the rest. </summary>
+	static void FindMasked(const Pattern& pattern, const uint8_t* data, const size_t size, const size_t limit, const uint64_t address, std::vector<uint64_t>& out)
+	{
+		const size_t length = pattern.bytes.size();
+		if (size < length) return;
+		const size_t end = std::min(limit, size - length + 1);
+
+		auto verify = [&](const size_t i)
+		{
+			if (i % pattern.alignment != 0) return;
+			for (size_t k = 0; k < length; k++)
+				if ((data[i + k] ^ pattern.bytes[k]) & pattern.mask[k]) return;
+			out.push_back(address + i);
+		};
+
+		//Anchor on the first byte which has to match exactly
+		size_t anchor = 0;
+		while (anchor < length && pattern.mask[anchor] != 0xFF) anchor++;
+		if (anchor == length)
+		{
+			for (size_t i = 0; i < end; i++) verify(i);
+			return;
+		}
+
+		size_t i = 0;
+#if defined(__AVX2__)
+		const __m256i needle = _mm256_set1_epi8((char)pattern.bytes[anchor]);
+		for (; i + anchor + 32 <= size && i < end; i += 32)
+		{
+			const __m256i block = _mm256_loadu_si256((const __m256i*)(data + i + anchor));
+			for (uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)); bits; bits &= bits - 1)
+			{
+				const size_t pos = i + LowestBit(bits);
+				if (pos < end) verify(pos);
+			}
+		}
+#elif defined(__SSE2__) || defined(_M_X64)
+		const __m128i needle = _mm_set1_epi8((char)pattern.bytes[anchor]);
+		for (; i + anchor + 16 <= size && i < end; i += 16)
+		{
+			const __m128i block = _mm_loadu_si128((const __m128i*)(data + i + anchor));
+			for (uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)); bits; bits &= bits - 1)
+			{
+				const size_t pos = i + LowestBit(bits);
+				if (pos < end) verify(pos);
+			}
+		}
+#endif
+		for (; i < end; i++)
+			if (data[i + anchor] == pattern.bytes[anchor]) verify(i);
+	}
+};
@@ -0,0 +1,355 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ProcessMemory.hpp"
+
+/// <summary> Watches values in the memory of a process from a background thread and reports their changes. </summary>
+class MemoryWatcher
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef uint32_t WatchId;
+	typedef std::function<void(const uint8_t* previous, const uint8_t* current)> Callback;
+
+	/// <summary> Statistics of a single watch. </summary>
+	struct Stats
+	{
+		uint64_t reads = 0; //Successful reads
+		uint64_t failures = 0; //Failed reads
+		uint64_t changes = 0; //Dispatched changes
+		Clock::duration lastLatency = Clock::duration::zero(); //Time between the due time and the end of the last read
+		Clock::duration maxLatency = Clock::duration::zero();
+		Clock::duration totalLatency = Clock::duration::zero();
+
+		/// <summary> Returns the average latency of the reads </summary>
+		inline const Clock::duration AverageLatency() const noexcept
+		{
+			return reads + failures ? totalLatency / (int64_t)(reads + failures) : Clock::duration::zero();
+		}
+	};
+protected:
+	struct Entry
+	{
+		uint64_t address; //Address of the value, unused if path is set
+		std::shared_ptr<PointerPath> path; //Pointer path of the value, shared with a batch in flight
+		size_t size;
+		Clock::duration interval;
+		Clock::time_point due; //Next scheduled read
+		std::vector<uint8_t> previous, current;
+		bool hasValue = false;
+		Callback callback;
+		Stats stats;
+	};
+
+	struct Schedule
+	{
+		Clock::time_point due;
+		WatchId id;
+		inline bool operator > (const Schedule& other) const noexcept
+		{
+			return due > other.due;
+		}
+	};
+
+	//Watch read by the current batch, the watcher lock is released during the read
+	struct Pending
+	{
+		WatchId id;
+		Clock::time_point due;
+		std::shared_ptr<PointerPath> path;
+		uint64_t address;
+		size_t size;
+		size_t offset; //In the batch buffer
+		bool valid; //False if the pointer path couldn't be resolved
+	};
+
+	struct Change
+	{
+		Callback callback;
+		std::vector<uint8_t> previous, current;
+	};
+
+	const ProcessMemory& process;
+	std::unordered_map<WatchId, Entry> watches;
+	std::priority_queue<Schedule, std::vector<Schedule>, std::greater<Schedule>> queue; //Removed watches are dropped lazily
+	WatchId nextId = 1;
+	Clock::duration slack; //Watches due within this window are read in the same batch
+	Clock::duration minInterval; //Lower bound of the watch intervals
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::thread thread;
+	bool running = false;
+public:
+	/// <summary> Creates a watcher, the background thread is started by Start </summary>
+	/// <param name="process"> Process to watch </param>
+	/// <param name="slack"> Watches due within this window are read in the same batch (Optional) </param>
+	/// <param name="minInterval"> Lower bound of the watch intervals (Optional) </param>
+	MemoryWatcher(const ProcessMemory& process, const Clock::duration slack = std::chrono::milliseconds(1), const Clock::duration minInterval = std::chrono::milliseconds(1))
+		: process(process), slack(slack), minInterval(minInterval)
+	{ }
+
+	MemoryWatcher(const MemoryWatcher&) = delete;
+	MemoryWatcher& operator = (const MemoryWatcher&) = delete;
+
+	~MemoryWatcher()
+	{
+		Stop();
+	}
+
+	/// <summary> Starts the background thread </summary>
+	void Start()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (running) return;
+		running = true;
+		//Called from a callback after Stop, the thread hasn't left its loop yet and simply continues
+		if (thread.joinable() && thread.get_id() == std::this_thread::get_id()) return;
+		if (thread.joinable())
+		{
+			//A thread stopped from its own callback is joined now
+			running = false;
+			lock.unlock();
+			thread.join();
+			lock.lock();
+			running = true;
+		}
+		thread = std::thread(&MemoryWatcher::Run, this);
+	}
+
+	/// <summary> Stops the background thread, the watches are kept. Can be called from a callback, the thread then exits once the callback returns
+	/// and is joined by the next Start or Stop. The watcher must not be destroyed from a callback. </summary>
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		wakeup.notify_all();
+		if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) thread.join();
+	}
+
+	/// <summary> Watches a value at a fixed address. The first read only records the value, changes after that call the callback from the background thread. </summary>
+	/// <param name="address"> Address of the value </param>
+	/// <param name="interval"> Time between reads </param>
+	/// <param name="callback"> Called with the previous and the current value </param>
+	/// <returns> Id of the watch </returns>
+	template <typename T>
+	WatchId Watch(const uint64_t address, const Clock::duration interval, std::function<void(const T&, const T&)> callback)
+	{
+		return Add(address, nullptr, sizeof(T), interval, Wrap(std::move(callback)));
+	}
+
+	/// <summary> Watches a value through a pointer path. The first read only records the value, changes after that call the callback from the background thread. </summary>
+	/// <param name="path"> Pointer path of the value, its epoch sets how often the chain is validated </param>
+	/// <param name="interval"> Time between reads </param>
+	/// <param name="callback"> Called with the previous and the current value </param>
+	/// <returns> Id of the watch </returns>
+	template <typename T>
+	WatchId Watch(const PointerPath& path, const Clock::duration interval, std::function<void(const T&, const T&)> callback)
+	{
+		return Add(0, std::make_shared<PointerPath>(path), sizeof(T), interval, Wrap(std::move(callback)));
+	}
+
+	/// <summary> Watches a block of raw memory at a fixed address. </summary>
+	/// <param name="address"> Address of the block </param>
+	/// <param name="size"> Size of the block </param>
+	/// <param name="interval"> Time between reads </param>
+	/// <param name="callback"> Called with the previous and the current content </param>
+	/// <returns> Id of the watch </returns>
+	WatchId WatchMemory(const uint64_t address, const size_t size, const Clock::duration interval, Callback callback)
+	{
+		return Add(address, nullptr, size, interval, std::move(callback));
+	}
+
+	/// <summary> Removes a watch, its callback isn't called after this returns unless a dispatch is already running </summary>
+	/// <returns> True if the watch existed </returns>
+	const bool Unwatch(const WatchId id)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return watches.erase(id) != 0;
+	}
+
+	/// <summary> Returns the statistics of a watch </summary>
+	/// <returns> True if the watch exists </returns>
+	const bool GetStats(const WatchId id, Stats& result)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto it = watches.find(id);
+		if (it == watches.end()) return false;
+		result = it->second.stats;
+		return true;
+	}
+
+	/// <summary> Returns the number of watches </summary>
+	const size_t GetWatchCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return watches.size();
+	}
+protected:
+	template <typename T>
+	static Callback Wrap(std::function<void(const T&, const T&)> callback)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "[class MemoryWatcher] Watched type must be trivially copyable");
+		return [callback](const uint8_t* previous, const uint8_t* current)
+		{
+			T a, b;
+			memcpy(&a, previous, sizeof(T));
+			memcpy(&b, current, sizeof(T));
+			callback(a, b);
+		};
+	}
+
+	WatchId Add(const uint64_t address, std::shared_ptr<PointerPath> path, const size_t size, const Clock::duration interval, Callback callback)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		const WatchId id = nextId++;
+		Entry& watch = watches[id];
+		watch.address = address;
+		watch.path = std::move(path);
+		watch.size = size;
+		watch.interval = std::max(interval, minInterval);
+		watch.due = Clock::now();
+		watch.previous.resize(size);
+		watch.current.resize(size);
+		watch.callback = std::move(callback);
+		queue.push({ watch.due, id });
+		lock.unlock();
+		wakeup.notify_all();
+		return id;
+	}
+
+	/// <summary> Body of the background thread </summary>
+	void Run()
+	{
+		std::vector<Pending> batch;
+		std::vector<ProcessMemory::ReadRequest> requests;
+		std::vector<uint8_t> buffer;
+		std::vector<Change> changes;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (running)
+		{
+			if (queue.empty())
+			{
+				wakeup.wait(lock);
+				continue;
+			}
+			if (queue.top().due > Clock::now())
+			{
+				wakeup.wait_until(lock, queue.top().due);
+				continue;
+			}
+
+			//Collect every watch due within the slack window, they are rescheduled only after the batch so none is read twice
+			const Clock::time_point start = Clock::now();
+			batch.clear();
+			size_t size = 0;
+			while (!queue.empty() && queue.top().due <= start + slack)
+			{
+				const Schedule entry = queue.top();
+				queue.pop();
+				const auto it = watches.find(entry.id);
+				if (it == watches.end() || it->second.due != entry.due) continue;
+				const Entry& watch = it->second;
+				batch.push_back({ entry.id, entry.due, watch.path, watch.address, watch.size, size, true });
+				size += watch.size;
+			}
+
+			//The process is read without the lock, Watch, Unwatch and Stop don't wait for it
+			lock.unlock();
+			buffer.resize(size);
+			requests.clear();
+			for (Pending& pending : batch)
+			{
+				if (pending.path)
+				{
+					pending.valid = process.Validate(*pending.path);
+					pending.address = pending.path->GetAddress();
+				}
+				requests.push_back({ pending.address, pending.valid ? pending.size : 0, buffer.data() + pending.offset });
+			}
+			process.ReadMemoryBatch(requests);
+			const Clock::time_point done = Clock::now();
+			lock.lock();
+
+			//Compare against the previous values of the watches that still exist
+			changes.clear();
+			for (size_t i = 0; i < batch.size(); i++)
+			{
+				const Pending& pending = batch[i];
+				const auto it = watches.find(pending.id);
+				if (it == watches.end() || it->second.due != pending.due) continue;
+				Entry& watch = it->second;
+				const bool success = pending.valid && requests[i].success;
+				if (success)
+				{
+					memcpy(watch.current.data(), buffer.data() + pending.offset, watch.size);
+					const bool changed = watch.hasValue && memcmp(watch.previous.data(), watch.current.data(), watch.size) != 0;
+					if (changed) changes.push_back({ watch.callback, watch.previous, watch.current });
+					watch.hasValue = true;
+					watch.previous.swap(watch.current);
+					watch.stats.changes += changed;
+				}
+				else if (pending.valid && watch.path) watch.path->Invalidate();
+				Finish(pending.id, watch, success, start, done);
+			}
+
+			//Callbacks may add or remove watches
+			lock.unlock();
+			for (auto& change : changes) change.callback(change.previous.data(), change.current.data());
+			lock.lock();
+		}
+	}
+
+	/// <summary> Updates the statistics and schedules the next read of a watch </summary>
+	/// <param name="start"> Start of the batch, the next read is scheduled after it </param>
+	/// <param name="done"> End of the read </param>
+	void Finish(const WatchId id, Entry& watch, const bool success, const Clock::time_point start, const Clock::time_point done)
+	{
+		const Clock::duration latency = done > watch.due ? done - watch.due : Clock::duration::zero();
+		(success ? watch.stats.reads : watch.stats.failures)++;
+		watch.stats.lastLatency = latency;
+		watch.stats.maxLatency = std::max(watch.stats.maxLatency, latency);
+		watch.stats.totalLatency += latency;
+
+		//Missed reads are skipped instead of being caught up
+		watch.due += watch.interval;
+		if (watch.due <= start) watch.due = start + watch.interval;
+		queue.push({ watch.due, id });
+	}
+};
@@ -0,0 +1,315 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MemoryScanner.hpp"
+
+/// <summary> Finds static multi-level pointer chains leading to an address. </summary>
+class PointerScanner : public MemoryScanner
+{
+public:
+	/// <summary> Pointer chain starting in a module, in the form ReadMemoryValue accepts </summary>
+	struct Result
+	{
+		std::string module; //Module holding the first pointer
+		uint64_t moduleOffset; //Offset of the first pointer from the module base
+		std::vector<uint64_t> offsets; //List of multi-level pointers
+
+		/// <summary> Creates a pointer path for the current module base of the process </summary>
+		PointerPath ToPath(const ProcessMemory& process, const uint32_t epoch = 0) const
+		{
+			return PointerPath(process.GetModuleAddr(module) + moduleOffset, offsets, epoch);
+		}
+	};
+protected:
+	static constexpr uint64_t AddressLimit = 1ull << 48; //Larger values aren't user space pointers
+	static constexpr size_t BlockEntries = 64; //Entries of the index decoded at once
+
+	/// <summary> Pointer found while building the index, values and addresses are packed into 48 bits </summary>
+	struct Packed
+	{
+		uint32_t valueLow, addressLow;
+		uint16_t valueHigh, addressHigh;
+
+		inline const uint64_t Value() const noexcept
+		{
+			return (uint64_t)valueHigh << 32 | valueLow;
+		}
+		inline const uint64_t Address() const noexcept
+		{
+			return (uint64_t)addressHigh << 32 | addressLow;
+		}
+	};
+
+	/// <summary> Index block, entries are stored as a varint value delta followed by a 6 byte address </summary>
+	struct Block
+	{
+		uint64_t firstValue;
+		size_t offset; //Offset of the first entry in data
+		uint32_t count;
+	};
+
+	std::vector<Block> blocks;
+	std::vector<uint8_t> data; //Encoded entries sorted by value
+	size_t entries = 0;
+	bool truncated = false;
+
+	size_t maxDepth = 5;
+	uint64_t maxOffset = 0x1000;
+	size_t maxResults = 10000;
+	size_t maxEntries = 64 << 20; //Roughly 768 MB while building, about half of it once compressed
+public:
+	/// <summary> Creates a pointer scanner, the index is built by BuildIndex </summary>
+	/// <param name="process"> Process to scan </param>
+	/// <param name="threads"> Number of worker threads, 0 uses every hardware thread (Optional) </param>
+	PointerScanner(const ProcessMemory& process, const size_t threads = 0) : MemoryScanner(process, threads)
+	{
+		filter = Region_Writable;
+	}
+
+	/// <summary> Sets the longest chain searched </summary>
+	inline void SetMaxDepth(const size_t value) noexcept
+	{
+		maxDepth = value;
+	}
+
+	/// <summary> Sets the largest offset added to a pointer </summary>
+	inline void SetMaxOffset(const uint64_t value) noexcept
+	{
+		maxOffset = value;
+	}
+
+	/// <summary> Sets the number of chains after which the search stops </summary>
+	inline void SetMaxResults(const size_t value) noexcept
+	{
+		maxResults = value;
+	}
+
+	/// <summary> Sets the number of pointers the index may hold, this bounds its memory use </summary>
+	inline void SetMaxEntries(const size_t value) noexcept
+	{
+		maxEntries = value;
+	}
+
+	/// <summary> Returns the number of pointers in the index </summary>
+	inline const size_t GetEntryCount() const noexcept
+	{
+		return entries;
+	}
+
+	/// <summary> Returns true if the last index hit the entry limit and is missing pointers </summary>
+	inline const bool IsTruncated() const noexcept
+	{
+		return truncated;
+	}
+
+	/// <summary> Returns the memory used by the index in bytes </summary>
+	inline const size_t GetIndexSize() const noexcept
+	{
+		return data.size() + blocks.size() * sizeof(Block);
+	}
+
+	/// <summary> Collects every aligned value of the writable regions that points into a readable region, sorted by value. </summary>
+	/// <returns> False if the index hit the entry limit </returns>
+	const bool BuildIndex()
+	{
+		//Sorted list of the readable ranges a pointer may point into
+		std::vector<std::pair<uint64_t, uint64_t>> targets;
+		for (const auto& region : process.GetRegions())
+		{
+			if (!targets.empty() && targets.back().second == region.base) targets.back().second += region.size;
+			else targets.push_back({ region.base, region.base + region.size });
+		}
+		if (targets.empty()) return false;
+		const uint64_t low = targets.front().first;
+		const uint64_t high = std::min(targets.back().second, AddressLimit);
+
+		//Every worker collects into its own list
+		std::vector<std::vector<Packed>> found(threads);
+		std::atomic<size_t> total(0);
+		std::atomic<bool> full(false); //Shared by the workers, copied to truncated after the scan
+		ScanChunks(sizeof(uint64_t), [&](const uint8_t* chunk, const size_t size, const size_t limit, const uint64_t address, const size_t thread)
+		{
+			if (full) return;
+			std::vector<Packed>& out = found[thread];
+			const size_t before = out.size();
+			const size_t end = std::min(limit, size - size % sizeof(uint64_t));
+			for (size_t i = 0; i < end; i += sizeof(uint64_t))
+			{
+				uint64_t value;
+				memcpy(&value, chunk + i, sizeof(value));
+				if (value < low || value >= high) continue;
+				const auto it = std::upper_bound(targets.begin(), targets.end(), value, [](const uint64_t& v, const std::pair<uint64_t, uint64_t>& t) { return v < t.first; });
+				if (it == targets.begin() || value >= std::prev(it)->second) continue;
+				const uint64_t where = address + i;
+				out.push_back({ (uint32_t)value, (uint32_t)where, (uint16_t)(value >> 32), (uint16_t)(where >> 32) });
+			}
+			if ((total += out.size() - before) > maxEntries) full = true;
+		});
+		truncated = full;
+
+		//Sort the lists in parallel, then merge them into the compressed index
+		std::vector<std::thread> pool;
+		for (auto& list : found) pool.emplace_back([&list]() { std::sort(list.begin(), list.end(), [](const Packed& a, const Packed& b) { return a.Value() < b.Value(); }); });
+		for (auto& t : pool) t.join();
+
+		blocks.clear();
+		data.clear();
+		entries = 0;
+		std::vector<size_t> heads(found.size(), 0);
+		uint64_t previous = 0;
+		while (true)
+		{
+			size_t best = found.size();
+			for (size_t i = 0; i < found.size(); i++)
+				if (heads[i] < found[i].size() && (best == found.size() || found[i][heads[i]].Value() < found[best][heads[best]].Value())) best = i;
+			if (best == found.size()) break;
+			const Packed& entry = found[best][heads[best]++];
+
+			if (entries % BlockEntries == 0)
+			{
+				blocks.push_back({ entry.Value(), data.size(), 0 });
+				previous = entry.Value();
+			}
+			for (uint64_t delta = entry.Value() - previous; ; delta >>= 7)
+			{
+				data.push_back((uint8_t)(delta & 0x7F) | (delta >= 0x80 ? 0x80 : 0));
+				if (delta < 0x80) break;
+			}
+			const uint64_t where = entry.Address();
+			for (int b = 0; b < 6; b++) data.push_back((uint8_t)(where >> (b * 8)));
+			previous = entry.Value();
+			blocks.back().count++;
+			entries++;
+
+			//Give back the memory of finished lists early
+			if (heads[best] == found[best].size()) std::vector<Packed>().swap(found[best]);
+		}
+		data.shrink_to_fit();
+		return !truncated;
+	}
+
+	/// <summary> Searches backwards from the target for chains that start in a module. Builds the index first if it's empty. </summary>
+	/// <param name="target"> Address the chains have to lead to </param>
+	/// <returns> List of chains, shortest chains first </returns>
+	std::vector<Result> Find(const uint64_t target)
+	{
+		if (entries == 0) BuildIndex();
+
+		//The pointers to the target are split between the workers
+		std::vector<std::pair<uint64_t, uint64_t>> first;
+		ForEachPointer(target, [&first](const uint64_t value, const uint64_t address) { first.push_back({ value, address }); });
+
+		//The workers search one copy of the module list, the cache of the process may be refreshed meanwhile
+		const std::vector<ProcessMemory::ModuleInfo> modules = process.GetModules();
+		std::vector<Result> results;
+		std::mutex mutex;
+		std::atomic<size_t> next(0), count(0);
+		auto worker = [&]()
+		{
+			std::vector<uint64_t> offsets;
+			std::vector<Result> local;
+			for (size_t i = next++; i < first.size() && count < maxResults; i = next++)
+			{
+				offsets.assign(1, target - first[i].first);
+				Search(modules, first[i].second, 1, offsets, local, count);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			results.insert(results.end(), local.begin(), local.end());
+		};
+		std::vector<std::thread> pool;
+		for (size_t i = 1; i < threads; i++) pool.emplace_back(worker);
+		worker();
+		for (auto& t : pool) t.join();
+
+		std::sort(results.begin(), results.end(), [](const Result& a, const Result& b)
+		{
+			if (a.offsets.size() != b.offsets.size()) return a.offsets.size() < b.offsets.size();
+			if (a.module != b.module) return a.module < b.module;
+			return a.moduleOffset < b.moduleOffset;
+		});
+		if (results.size() > maxResults) results.resize(maxResults);
+		return results;
+	}
+protected:
+	/// <summary> Depth first search from a pointer's location towards the modules </summary>
+	/// <param name="modules"> Loaded modules sorted by base address </param>
+	/// <param name="address"> Location of the pointer found in the previous step </param>
+	/// <param name="depth"> Length of the chain so far </param>
+	/// <param name="offsets"> Offsets from the location towards the target, in reverse order </param>
+	void Search(const std::vector<ProcessMemory::ModuleInfo>& modules, const uint64_t address, const size_t depth, std::vector<uint64_t>& offsets, std::vector<Result>& out, std::atomic<size_t>& count) const
+	{
+		//A pointer stored inside a module ends the chain
+		if (const ProcessMemory::ModuleInfo* module = ProcessMemory::FindModule(modules, address))
+		{
+			if (count++ >= maxResults) return;
+			out.push_back({ module->name, address - module->base, std::vector<uint64_t>(offsets.rbegin(), offsets.rend()) });
+			return;
+		}
+		if (depth >= maxDepth) return;
+
+		ForEachPointer(address, [&](const uint64_t value, const uint64_t location)
+		{
+			if (count >= maxResults) return;
+			offsets.push_back(address - value);
+			Search(modules, location, depth + 1, offsets, out, count);
+			offsets.pop_back();
+		});
+	}
+
+	/// <summary> Calls the function for every pointer of the index whose value is at most maxOffset below the target </summary>
+	template <typename F>
+	void ForEachPointer(const uint64_t target, F function) const
+	{
+		const uint64_t low = target > maxOffset ? target - maxOffset : 0;
+		auto block = std::upper_bound(blocks.begin(), blocks.end(), low, [](const uint64_t& v, const Block& b) { return v < b.firstValue; });
+		if (block != blocks.begin()) --block;
+		for (; block != blocks.end() && block->firstValue <= target; ++block)
+		{
+			const uint8_t* p = data.data() + block->offset;
+			uint64_t value = block->firstValue;
+			for (uint32_t i = 0; i < block->count; i++)
+			{
+				uint64_t delta = 0;
+				for (int shift = 0; ; shift += 7)
+				{
+					delta |= (uint64_t)(*p & 0x7F) << shift;
+					if (!(*p++ & 0x80)) break;
+				}
+				value += delta;
+				uint64_t address = 0;
+				for (int b = 0; b < 6; b++) address |= (uint64_t)*p++ << (b * 8);
+				if (value > target) return;
+				if (value >= low) function(value, address);
+			}
+		}
+	}
+};
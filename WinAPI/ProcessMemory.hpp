@@ -25,26 +25,164 @@ SOFTWARE.
 #pragma once
 #include <string>
 #include <initializer_list>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
+#ifdef _WIN32
 //Windows headers
 #include <Windows.h>
 #include <Psapi.h>
 #include <tlhelp32.h>
+#else
+//Linux headers
+#include <cerrno>
+#include <fstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
-/// <summary> Opens a process for memory reading and writing. </summary>
+/// <summary> Multi-level pointer which caches its resolved address. </summary>
+class PointerPath
+{
+protected:
+	friend class ProcessMemory;
+	uint64_t base; //Base address
+	std::vector<uint64_t> offsets; //List of multi-level pointers
+	uint32_t epoch; //Number of accesses trusted without validation
+	uint32_t accesses = 0; //Accesses since the last validation
+	bool resolved = false; //True if the cached addresses are filled
+	uint64_t slot = 0; //Address of the last pointer of the chain
+	uint64_t pointer = 0; //Value of the last pointer when the path was resolved
+	uint64_t address = 0; //Resolved final address
+public:
+	/// <summary> Creates a pointer path </summary>
+	/// <param name="base"> Base address </param>
+	/// <param name="offsets"> List of multi-level pointers (Optional) </param>
+	/// <param name="epoch"> Number of accesses between validations of the last pointer, 0 validates on every access (Optional) </param>
+	PointerPath(const uint64_t base, const std::initializer_list<uint64_t> offsets = {}, const uint32_t epoch = 0) : base(base), offsets(offsets), epoch(epoch)
+	{ }
+
+	/// <summary> Creates a pointer path </summary>
+	/// <param name="base"> Base address </param>
+	/// <param name="offsets"> List of multi-level pointers </param>
+	/// <param name="epoch"> Number of accesses between validations of the last pointer, 0 validates on every access (Optional) </param>
+	PointerPath(const uint64_t base, std::vector<uint64_t> offsets, const uint32_t epoch = 0) : base(base), offsets(std::move(offsets)), epoch(epoch)
+	{ }
+
+	/// <summary> Forces a full walk of the chain on the next access </summary>
+	inline void Invalidate() noexcept
+	{
+		resolved = false;
+	}
+
+	/// <summary> Sets the number of accesses between validations </summary>
+	inline void SetEpoch(const uint32_t value) noexcept
+	{
+		epoch = value;
+	}
+
+	/// <summary> Returns true if the path has a cached address </summary>
+	inline const bool IsResolved() const noexcept
+	{
+		return resolved;
+	}
+
+	/// <summary> Returns the cached final address </summary>
+	/// <returns> Final address, 0 if the path isn't resolved </returns>
+	inline const uint64_t GetAddress() const noexcept
+	{
+		return resolved ? address : 0;
+	}
+
+	inline const uint64_t GetBase() const noexcept
+	{
+		return base;
+	}
+
+	inline const std::vector<uint64_t>& GetOffsets() const noexcept
+	{
+		return offsets;
+	}
+};
+
+/// <summary> Opens a process for memory reading and writing. The const members can be called from several threads at once, Open and Close can't. </summary>
 class ProcessMemory
 {
 protected:
+#ifdef _WIN32
 	HANDLE handle = NULL; //Process handle
 	DWORD pid = NULL; //Process id
+#else
+	pid_t pid = 0; //Process id
+	mutable std::atomic<int> memFd{ -1 }; //Handle of /proc/pid/mem, opened on first fallback
+	mutable std::mutex memMutex; //Guards opening memFd
+	mutable std::atomic<bool> vmCalls{ true }; //False if process_vm_readv/writev is not available
+#endif
+public:
+	/// <summary> Describes one read of a batch. </summary>
+	struct ReadRequest
+	{
+		uint64_t address; //Address to read from
+		size_t size; //Number of bytes to read
+		void* destination; //Buffer to read into
+		bool success = false; //Set by ReadMemoryBatch
+	};
+
+	/// <summary> Describes a mapped memory region of the process. </summary>
+	struct MemoryRegion
+	{
+		uint64_t base; //Start address
+		uint64_t size; //Size in bytes
+		bool readable;
+		bool writable;
+		bool executable;
+	};
+
+	/// <summary> Describes a loaded module of the process. </summary>
+	struct ModuleInfo
+	{
+		std::string name; //Name of the module
+		uint64_t base; //Start address
+		uint64_t size; //Size of the image in bytes
+	};
+protected:
+	mutable std::mutex moduleMutex; //Guards the module cache below
+	mutable std::vector<ModuleInfo> modules; //Loaded modules sorted by base address
+	mutable std::unordered_map<std::string, ModuleInfo> moduleIndex; //Lower case module names
+	mutable uint64_t moduleSignature = 0; //Fingerprint of the module list when the index was built
+	mutable std::chrono::steady_clock::time_point moduleCheck; //Last time the module list was checked
+	mutable bool modulesLoaded = false;
+	std::chrono::steady_clock::duration moduleCheckInterval = std::chrono::seconds(1);
 public:
+
+	ProcessMemory() = default;
+	ProcessMemory(const ProcessMemory&) = delete;
+	ProcessMemory& operator = (const ProcessMemory&) = delete;
+
+	~ProcessMemory()
+	{
+		if (pid) Close();
+	}
+
+#ifdef _WIN32
 	/// <summary> Opens the process by window title </summary>
 	/// <param name="title"> Title of the window </param>
 	/// <returns> True on success </returns>
 	const bool OpenByWindowTitle(const std::string title)
 	{
-		handle = NULL;
-		pid = NULL;
+		if (pid) Close();
 		//Find window by title
 		HWND hwnd = FindWindow(NULL, title.c_str());
 		if (hwnd == NULL) return false;
@@ -58,14 +196,35 @@ public:
 		handle = OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE | PROCESS_QUERY_INFORMATION, FALSE, pid);
 		return handle != NULL;
 	}
+#endif
+
+	/// <summary> Opens the process by process id </summary>
+	/// <param name="id"> Id of the process </param>
+	/// <returns> True on success </returns>
+	const bool OpenByPid(const uint32_t id)
+	{
+#ifdef _WIN32
+		if (pid) Close();
+		pid = id;
+		handle = OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE | PROCESS_QUERY_INFORMATION | PROCESS_TERMINATE, FALSE, pid);
+		if (handle == NULL) pid = NULL;
+		return handle != NULL;
+#else
+		if (pid) Close();
+		//The process exists if it can be signaled, or if we just lack the permission to do so
+		if (id == 0 || (kill((pid_t)id, 0) != 0 && errno != EPERM)) return false;
+		pid = (pid_t)id;
+		return true;
+#endif
+	}
 
 	/// <summary> Opens the process by executable name </summary>
 	/// <param name="title"> Name of the executable </param>
 	/// <returns> True on success </returns>
 	const bool OpenByExecutableName(const std::string executable)
 	{
-		handle = NULL;
-		pid = NULL;
+#ifdef _WIN32
+		if (pid) Close();
 		//Query list of processes
 		HANDLE snap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, NULL);
 		if (snap == INVALID_HANDLE_VALUE) return NULL;
@@ -79,9 +238,8 @@ public:
 		{
 			do
 			{
-				const std::string current = entry.szExeFile;
 				//Case insensitive comparision
-				if (std::equal(executable.begin(), executable.end(), current.begin(), current.end(), [](const char& a, const char& b) { return std::tolower(a) == std::tolower(b);  }))
+				if (EqualsIgnoreCase(executable, entry.szExeFile))
 				{
 					pid = entry.th32ProcessID;
 					break;
@@ -95,13 +253,50 @@ public:
 		//Open the process
 		if (pid != NULL) handle = OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE | PROCESS_QUERY_INFORMATION | PROCESS_TERMINATE, FALSE, pid);
 		return handle != NULL;
+#else
+		if (pid) Close();
+		DIR* proc = opendir("/proc");
+		if (proc == nullptr) return false;
+
+		//Loop through each process directory
+		uint32_t found = 0;
+		while (dirent* entry = readdir(proc))
+		{
+			if (!std::all_of(entry->d_name, entry->d_name + strlen(entry->d_name), [](const char& c) { return std::isdigit((unsigned char)c); })) continue;
+			const std::string dir = std::string("/proc/") + entry->d_name;
+
+			//Name of the executable image, or the (truncated) command name if the link is not readable
+			char path[4096];
+			const ssize_t len = readlink((dir + "/exe").c_str(), path, sizeof(path) - 1);
+			std::string current;
+			if (len > 0) current = BaseName(std::string(path, len));
+			else std::getline(std::ifstream(dir + "/comm"), current);
+
+			//Case insensitive comparision
+			if (EqualsIgnoreCase(executable, current))
+			{
+				found = (uint32_t)std::atoi(entry->d_name);
+				break;
+			}
+		}
+		closedir(proc);
+
+		//Open the process
+		return found != 0 && OpenByPid(found);
+#endif
 	}
 
 	/// <summary> Terminates the process and closes the handle. </summary>
 	/// <returns> True on success </returns>
 	const bool Terminate(const uint32_t exitcode = EXIT_SUCCESS)
 	{
+#ifdef _WIN32
 		const bool result = TerminateProcess(handle, exitcode);
+#else
+		//Signals can't carry an exit code, the process is killed just like TerminateProcess would do
+		(void)exitcode;
+		const bool result = pid != 0 && kill(pid, SIGKILL) == 0;
+#endif
 		Close();
 		return result;
 	}
@@ -110,21 +305,110 @@ public:
 	/// <returns> True on success </returns>
 	const bool Close()
 	{
+#ifdef _WIN32
 		pid = NULL;
 		const bool result = CloseHandle(handle);
 		handle = NULL;
-		return handle;
+#else
+		const bool result = pid != 0;
+		const int fd = memFd.exchange(-1);
+		if (fd != -1) close(fd);
+		vmCalls = true;
+		pid = 0;
+#endif
+		std::lock_guard<std::mutex> lock(moduleMutex);
+		modules.clear();
+		moduleIndex.clear();
+		modulesLoaded = false;
+		return result;
 	}
 
-	/// <summary> Finds the address of the given module. </summary>
+	/// <summary> Returns the id of the opened process. </summary>
+	/// <returns> Process id, 0 if no process is opened </returns>
+	inline const uint32_t GetPid() const noexcept
+	{
+		return (uint32_t)pid;
+	}
+
+	/// <summary> Finds the address of the given module. The module list is cached and checked for changes at most once per check interval. </summary>
 	/// <param name="module"> Name of the module </param>
 	/// <returns> Module address, 0 on fail </returns>
 	const uint64_t GetModuleAddr(const std::string module) const
 	{
-		uint64_t result = NULL;
-		//Query list of modules
+		std::lock_guard<std::mutex> lock(moduleMutex);
+		const ModuleInfo* info = LookupModule(module);
+		return info ? info->base : 0;
+	}
+
+	/// <summary> Finds the given module. </summary>
+	/// <param name="module"> Name of the module </param>
+	/// <returns> Module details, nullptr on fail. Valid until the module list changes, which any lookup on another thread can do. Threads sharing the object should use GetModuleAddr or GetModules. </returns>
+	const ModuleInfo* GetModule(const std::string& module) const
+	{
+		std::lock_guard<std::mutex> lock(moduleMutex);
+		return LookupModule(module);
+	}
+
+	/// <summary> Finds the module that contains the given address. </summary>
+	/// <param name="address"> Address inside the module </param>
+	/// <returns> Module details, nullptr on fail. Valid until the module list changes, see GetModule. </returns>
+	const ModuleInfo* GetModuleByAddress(const uint64_t address) const
+	{
+		std::lock_guard<std::mutex> lock(moduleMutex);
+		CheckModules();
+		return FindModule(modules, address);
+	}
+
+	/// <summary> Finds the module that contains the given address in a list sorted by base address, like a copy returned by GetModules. </summary>
+	/// <returns> Module details, nullptr on fail </returns>
+	static const ModuleInfo* FindModule(const std::vector<ModuleInfo>& list, const uint64_t address)
+	{
+		auto it = std::upper_bound(list.begin(), list.end(), address, [](const uint64_t& a, const ModuleInfo& m) { return a < m.base; });
+		if (it == list.begin()) return nullptr;
+		--it;
+		return address - it->base < it->size ? &*it : nullptr;
+	}
+
+	/// <summary> Returns a copy of every loaded module sorted by base address. </summary>
+	std::vector<ModuleInfo> GetModules() const
+	{
+		std::lock_guard<std::mutex> lock(moduleMutex);
+		CheckModules();
+		return modules;
+	}
+
+	/// <summary> Sets how often the module list is checked for loaded or unloaded modules. </summary>
+	inline void SetModuleCheckInterval(const std::chrono::steady_clock::duration value) noexcept
+	{
+		moduleCheckInterval = value;
+	}
+
+	/// <summary> Rebuilds the module index if the module list changed. </summary>
+	/// <returns> True if the index was rebuilt </returns>
+	const bool RefreshModules() const
+	{
+		std::lock_guard<std::mutex> lock(moduleMutex);
+		return UpdateModules();
+	}
+protected:
+	/// <summary> Rebuilds the module index if the module list changed, moduleMutex has to be locked. </summary>
+	const bool UpdateModules() const
+	{
+		moduleCheck = std::chrono::steady_clock::now();
+#ifdef _WIN32
+		//Module handles are cheap to list compared to a toolhelp snapshot
+		HMODULE handles[1024];
+		DWORD needed = 0;
+		uint64_t signature = 0;
+		if (EnumProcessModulesEx(handle, handles, sizeof(handles), &needed, LIST_MODULES_ALL))
+		{
+			signature = Hash(handles, std::min<size_t>(needed, sizeof(handles))) + needed;
+			if (modulesLoaded && signature == moduleSignature) return false;
+		}
+
+		std::vector<ModuleInfo> list;
 		HANDLE snap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, pid);
-		if (snap == INVALID_HANDLE_VALUE) return NULL;
+		if (snap == INVALID_HANDLE_VALUE) return false;
 
 		MODULEENTRY32 entry;
 		entry.dwSize = sizeof(entry);
@@ -133,18 +417,107 @@ public:
 		{
 			do
 			{
-				const std::string current = entry.szModule;
-				//Case insensitive comparision
-				if (std::equal(module.begin(), module.end(), current.begin(), current.end(), [](const char& a, const char& b) { return std::tolower(a) == std::tolower(b);  }))
-				{
-					result = (uint64_t)entry.modBaseAddr;
-					break;
-				}
+				list.push_back({ entry.szModule, (uint64_t)entry.modBaseAddr, (uint64_t)entry.modBaseSize });
 			} while (Module32Next(snap, &entry));
 		}
 
 		//Close handle
 		CloseHandle(snap);
+#else
+		//The file backed mappings make up the signature, anonymous mappings change all the time
+		std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+		std::string line;
+		std::vector<std::string> lines;
+		uint64_t signature = Hash(nullptr, 0);
+		while (std::getline(maps, line))
+		{
+			//Format: start-end perms offset dev inode path
+			if (line.find('/') == std::string::npos) continue;
+			signature = Hash(line.data(), line.size(), signature);
+			lines.push_back(std::move(line));
+		}
+		if (modulesLoaded && signature == moduleSignature) return false;
+
+		//Mappings are listed in ascending order, so the first mapping of the file is the module base
+		std::vector<ModuleInfo> list;
+		std::unordered_map<std::string, size_t> byPath;
+		for (const auto& current : lines)
+		{
+			char* end;
+			const uint64_t begin = std::strtoull(current.c_str(), &end, 16);
+			const uint64_t finish = std::strtoull(end + 1, nullptr, 16);
+			const std::string path = current.substr(current.find('/'));
+			const auto it = byPath.find(path);
+			if (it == byPath.end())
+			{
+				byPath[path] = list.size();
+				list.push_back({ path, begin, finish - begin });
+			}
+			else list[it->second].size = finish - list[it->second].base;
+		}
+#endif
+
+		//Earlier entries win if two modules share a name
+		moduleIndex.clear();
+		modules.clear();
+		for (auto& module : list)
+		{
+#ifndef _WIN32
+			//Modules can be looked up by their full path too
+			const std::string path = module.name;
+			module.name = BaseName(path);
+			moduleIndex.emplace(ToLower(path), module);
+#endif
+			moduleIndex.emplace(ToLower(module.name), module);
+			modules.push_back(module);
+		}
+		std::sort(modules.begin(), modules.end(), [](const ModuleInfo& a, const ModuleInfo& b) { return a.base < b.base; });
+
+		moduleSignature = signature;
+		modulesLoaded = true;
+		return true;
+	}
+public:
+
+	/// <summary> Lists the committed memory regions of the process. </summary>
+	/// <param name="readableOnly"> Skip regions that can't be read (Optional) </param>
+	/// <returns> List of regions in ascending order </returns>
+	std::vector<MemoryRegion> GetRegions(const bool readableOnly = true) const
+	{
+		std::vector<MemoryRegion> result;
+#ifdef _WIN32
+		MEMORY_BASIC_INFORMATION info;
+		uint64_t address = 0;
+		while (VirtualQueryEx(handle, (void*)address, &info, sizeof(info)) == sizeof(info))
+		{
+			address = (uint64_t)info.BaseAddress + info.RegionSize;
+			if (info.State != MEM_COMMIT) continue;
+			MemoryRegion region;
+			region.base = (uint64_t)info.BaseAddress;
+			region.size = info.RegionSize;
+			region.readable = !(info.Protect & (PAGE_NOACCESS | PAGE_GUARD));
+			region.writable = (info.Protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+			region.executable = (info.Protect & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+			if (region.readable || !readableOnly) result.push_back(region);
+		}
+#else
+		std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+		std::string line;
+		while (std::getline(maps, line))
+		{
+			//Format: start-end perms offset dev inode path
+			char* end;
+			MemoryRegion region;
+			region.base = std::strtoull(line.c_str(), &end, 16);
+			region.size = std::strtoull(end + 1, &end, 16) - region.base;
+			region.readable = end[1] == 'r';
+			region.writable = end[2] == 'w';
+			region.executable = end[3] == 'x';
+			//The kernel's shared pages can't be read through process_vm_readv
+			if (line.find("[vvar]") != std::string::npos || line.find("[vsyscall]") != std::string::npos) region.readable = false;
+			if (region.readable || !readableOnly) result.push_back(region);
+		}
+#endif
 		return result;
 	}
 
@@ -156,77 +529,372 @@ public:
 	template <typename T>
 	inline const bool ReadMemoryValue(T & result, uint64_t address, const std::initializer_list<uint64_t> pointers = {}) const
 	{
-		//Simple read if no multi level pointers
-		if (pointers.size() == 0) return ReadProcessMemory(handle, (void*)address, &result, sizeof(result), NULL);
+		return ResolvePointers(address, pointers) && ReadMemory(address, &result, sizeof(result));
+	}
+
+	template <typename T>
+	inline const bool ReadMemoryArray(T * result, size_t len, uint64_t address, const std::initializer_list<uint64_t> pointers = {}) const
+	{
+		return ResolvePointers(address, pointers) && ReadMemory(address, result, len);
+	}
+
+	/// <summary> Modifies the memory of the process. </summary>
+	/// <param name="value"> Value to write </param>
+	/// <param name="address"> Base address </param>
+	/// <param name="pointers"> List of multi-level pointers (Optional) </param>
+	/// <returns> True on success </returns>
+	template <typename T>
+	inline const bool WriteMemoryValue(const T value, uint64_t address, const std::initializer_list<uint64_t> pointers = {}) const
+	{
+		return ResolvePointers(address, pointers) && WriteMemory(address, &value, sizeof(value));
+	}
+
+	/// <summary> Reads a value through a cached pointer path. </summary>
+	/// <param name="result"> Variable to read into </param>
+	/// <param name="path"> Pointer path, resolved on first use </param>
+	/// <returns> True on success </returns>
+	template <typename T>
+	inline const bool ReadMemoryValue(T & result, PointerPath& path) const
+	{
+		return ReadMemoryPath(path, &result, sizeof(result));
+	}
+
+	/// <summary> Reads an array through a cached pointer path. </summary>
+	/// <param name="result"> Array to read into </param>
+	/// <param name="len"> Number of bytes to read </param>
+	/// <param name="path"> Pointer path, resolved on first use </param>
+	/// <returns> True on success </returns>
+	template <typename T>
+	inline const bool ReadMemoryArray(T * result, size_t len, PointerPath& path) const
+	{
+		return ReadMemoryPath(path, result, len);
+	}
+
+	/// <summary> Modifies the memory of the process through a cached pointer path. </summary>
+	/// <param name="value"> Value to write </param>
+	/// <param name="path"> Pointer path, resolved on first use </param>
+	/// <returns> True on success </returns>
+	template <typename T>
+	inline const bool WriteMemoryValue(const T value, PointerPath& path) const
+	{
+		return Validate(path) && WriteMemory(path.address, &value, sizeof(value));
+	}
+
+	/// <summary> Walks the whole chain of the pointer path and caches the result. </summary>
+	/// <param name="path"> Pointer path to resolve </param>
+	/// <returns> True on success </returns>
+	const bool Resolve(PointerPath& path) const
+	{
+		path.resolved = false;
+		path.accesses = 0;
+		if (path.offsets.empty())
+		{
+			path.address = path.base;
+			return path.resolved = true;
+		}
 
 		//Read start address
-		if (!ReadProcessMemory(handle, (void*)address, &address, sizeof(address), NULL)) return false;
+		uint64_t address;
+		path.slot = path.base;
+		if (!ReadMemory(path.slot, &address, sizeof(address))) return false;
 
-		//Loop through the pointers
-		for (auto it = pointers.begin(); it != std::prev(pointers.end()); it++)
+		//Loop through the pointers, remembering where the last one was stored
+		for (auto it = path.offsets.begin(); it != std::prev(path.offsets.end()); it++)
 		{
-			address += *it;
-			if (!ReadProcessMemory(handle, (void*)address, &address, sizeof(address), NULL)) return false;
+			path.slot = address + *it;
+			if (!ReadMemory(path.slot, &address, sizeof(address))) return false;
 		}
 
-		//Read from last address to the result
-		address += *std::prev(pointers.end());
-		return ReadProcessMemory(handle, (void*)address, &result, sizeof(result), NULL);
+		path.pointer = address;
+		path.address = address + path.offsets.back();
+		return path.resolved = true;
 	}
 
-	template <typename T>
-	inline const bool ReadMemoryArray(T * result, size_t len, uint64_t address, const std::initializer_list<uint64_t> pointers = {}) const
+	/// <summary> Makes sure the cached address of the path is usable, validating the last pointer when it's due. </summary>
+	/// <param name="path"> Pointer path to check </param>
+	/// <returns> True if the path is resolved </returns>
+	const bool Validate(PointerPath& path) const
 	{
-		//Simple read if no multi level pointers
-		if (pointers.size() == 0) return ReadProcessMemory(handle, (void*)address, result, len, NULL);
+		if (!path.resolved || path.offsets.empty()) return path.resolved || Resolve(path);
+		if (path.accesses++ < path.epoch) return true;
+		path.accesses = 0;
 
-		//Read start address
-		if (!ReadProcessMemory(handle, (void*)address, &address, sizeof(address), NULL)) return false;
+		//Only the last pointer is read back, a full walk follows if it has moved
+		uint64_t pointer;
+		return (ReadMemory(path.slot, &pointer, sizeof(pointer)) && pointer == path.pointer) || Resolve(path);
+	}
 
-		//Loop through the pointers
-		for (auto it = pointers.begin(); it != std::prev(pointers.end()); it++)
+	/// <summary> Reads a block of raw memory from the process. </summary>
+	/// <param name="address"> Address to read from </param>
+	/// <param name="buffer"> Buffer to read into </param>
+	/// <param name="size"> Number of bytes to read </param>
+	/// <returns> True if the whole block was read </returns>
+	const bool ReadMemory(const uint64_t address, void* buffer, const size_t size) const
+	{
+#ifdef _WIN32
+		return ReadProcessMemory(handle, (void*)address, buffer, size, NULL);
+#else
+		if (vmCalls)
 		{
-			address += *it;
-			if (!ReadProcessMemory(handle, (void*)address, &address, sizeof(address), NULL)) return false;
+			iovec local = { buffer, size };
+			iovec remote = { (void*)address, size };
+			const ssize_t read = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+			if (read == (ssize_t)size) return true;
+			//Only fall back if the syscall itself is unavailable or blocked
+			if (read >= 0 || (errno != ENOSYS && errno != EPERM)) return false;
+			if (errno == ENOSYS) vmCalls = false;
 		}
+		return OpenMemFile() && pread(memFd, buffer, size, (off_t)address) == (ssize_t)size;
+#endif
+	}
 
-		//Read from last address to the result
-		address += *std::prev(pointers.end());
-		return ReadProcessMemory(handle, (void*)address, result, len, NULL);
+	/// <summary> Writes a block of raw memory to the process. </summary>
+	/// <param name="address"> Address to write to </param>
+	/// <param name="buffer"> Data to write </param>
+	/// <param name="size"> Number of bytes to write </param>
+	/// <returns> True if the whole block was written </returns>
+	const bool WriteMemory(const uint64_t address, const void* buffer, const size_t size) const
+	{
+#ifdef _WIN32
+		return WriteProcessMemory(handle, (void*)address, buffer, size, NULL);
+#else
+		if (vmCalls)
+		{
+			iovec local = { const_cast<void*>(buffer), size };
+			iovec remote = { (void*)address, size };
+			const ssize_t written = process_vm_writev(pid, &local, 1, &remote, 1, 0);
+			if (written == (ssize_t)size) return true;
+			//EFAULT is also returned for read-only pages, which /proc/pid/mem can still write
+			if (written >= 0 || (errno != ENOSYS && errno != EPERM && errno != EFAULT)) return false;
+			if (errno == ENOSYS) vmCalls = false;
+		}
+		return OpenMemFile() && pwrite(memFd, buffer, size, (off_t)address) == (ssize_t)size;
+#endif
 	}
 
-	/// <summary> Modifies the memory of the process. </summary>
-	/// <param name="value"> Value to write </param>
-	/// <param name="address"> Base address </param>
-	/// <param name="pointers"> List of multi-level pointers (Optional) </param>
-	/// <returns> True on success </returns>
-	template <typename T>
-	inline const bool WriteMemoryValue(const T value, uint64_t address, const std::initializer_list<uint64_t> pointers = {}) const
+	/// <summary> Reads many values from the process with as few calls as possible. Nearby requests are merged into one read, on Linux the merged ranges are read with vectored process_vm_readv calls. </summary>
+	/// <param name="requests"> List of reads, the success flag of each is updated </param>
+	/// <param name="count"> Number of requests </param>
+	/// <param name="maxGap"> Largest number of unused bytes between two requests that are still merged </param>
+	/// <returns> Number of successful requests </returns>
+	const size_t ReadMemoryBatch(ReadRequest* requests, const size_t count, const size_t maxGap = 256) const
 	{
-		//Simple write if no multi level pointers
-		if (pointers.size() == 0) return WriteProcessMemory(handle, (void*)address, &value, sizeof(value), NULL);
+		struct Span
+		{
+			uint64_t begin, end; //Remote range
+			size_t first, last; //Range in the sorted order
+			size_t offset; //Offset in the scratch buffer
+			bool success;
+		};
+		static thread_local std::vector<size_t> order;
+		static thread_local std::vector<Span> spans;
+		static thread_local std::vector<uint8_t> scratch;
 
-		//Read start address
-		if (!ReadProcessMemory(handle, (void*)address, &address, sizeof(address), NULL)) return false;
+		//Sort requests by address
+		order.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			requests[i].success = requests[i].size == 0;
+			if (requests[i].size != 0) order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [requests](const size_t& a, const size_t& b) { return requests[a].address < requests[b].address; });
 
-		//Loop through the pointers
-		for (auto it = pointers.begin(); it != std::prev(pointers.end()); it++)
+		//Merge nearby requests into spans
+		spans.clear();
+		size_t total = 0;
+		for (size_t i = 0; i < order.size(); i++)
 		{
-			address += *it;
-			if (!ReadProcessMemory(handle, (void*)address, &address, sizeof(address), NULL)) return false;
+			const ReadRequest& r = requests[order[i]];
+			if (!spans.empty() && r.address <= spans.back().end + maxGap)
+			{
+				spans.back().end = std::max(spans.back().end, r.address + r.size);
+				spans.back().last = i;
+				continue;
+			}
+			if (!spans.empty()) total += spans.back().end - spans.back().begin;
+			spans.push_back({ r.address, r.address + r.size, i, i, total, false });
 		}
+		if (!spans.empty()) total += spans.back().end - spans.back().begin;
+		if (scratch.size() < total) scratch.resize(total);
 
-		//Write the value to the address
-		address += *std::prev(pointers.end());
-		return WriteProcessMemory(handle, (void*)address, &value, sizeof(value), NULL);
+#ifdef _WIN32
+		for (Span& span : spans) span.success = ReadMemory(span.begin, scratch.data() + span.offset, span.end - span.begin);
+#else
+		static thread_local std::vector<iovec> local, remote;
+		const size_t maxIov = 1024; //UIO_MAXIOV
+		size_t next = 0;
+		while (next < spans.size() && vmCalls)
+		{
+			//Read as many spans as fit in one call
+			const size_t n = std::min(maxIov, spans.size() - next);
+			local.resize(n);
+			remote.resize(n);
+			for (size_t i = 0; i < n; i++)
+			{
+				const Span& span = spans[next + i];
+				local[i] = { scratch.data() + span.offset, span.end - span.begin };
+				remote[i] = { (void*)span.begin, span.end - span.begin };
+			}
+			ssize_t read = process_vm_readv(pid, local.data(), n, remote.data(), n, 0);
+			if (read < 0 && errno != EFAULT) break; //Leave the rest to ReadMemory
+
+			//Transfers stop at the first span that failed, nothing after it was read
+			const size_t end = next + n;
+			while (next < end && read > 0 && (size_t)read >= spans[next].end - spans[next].begin)
+			{
+				read -= spans[next].end - spans[next].begin;
+				spans[next++].success = true;
+			}
+			if (next < end) next++;
+		}
+		for (; next < spans.size(); next++) spans[next].success = ReadMemory(spans[next].begin, scratch.data() + spans[next].offset, spans[next].end - spans[next].begin);
+#endif
+
+		//Copy the results, retry failed spans one request at a time
+		size_t succeeded = 0;
+		for (const Span& span : spans)
+		{
+			for (size_t i = span.first; i <= span.last; i++)
+			{
+				ReadRequest& r = requests[order[i]];
+				if (span.success) memcpy(r.destination, scratch.data() + span.offset + (r.address - span.begin), r.size);
+				r.success = span.success || (span.first != span.last && ReadMemory(r.address, r.destination, r.size));
+			}
+		}
+		for (size_t i = 0; i < count; i++) succeeded += requests[i].success;
+		return succeeded;
+	}
+
+	/// <summary> Reads many values from the process with as few calls as possible. </summary>
+	/// <param name="requests"> List of reads, the success flag of each is updated </param>
+	/// <param name="maxGap"> Largest number of unused bytes between two requests that are still merged </param>
+	/// <returns> Number of successful requests </returns>
+	inline const size_t ReadMemoryBatch(std::vector<ReadRequest>& requests, const size_t maxGap = 256) const
+	{
+		return ReadMemoryBatch(requests.data(), requests.size(), maxGap);
 	}
 
 	/// <summary> Checks if the hande still exists. </summary>
 	/// <returns> State of the handle. </returns>
 	inline const bool IsValid() const
 	{
+#ifdef _WIN32
 		static DWORD ec;
 		GetExitCodeProcess(handle, &ec);
 		return ec == STILL_ACTIVE;
+#else
+		if (pid == 0) return false;
+		//Zombies are already dead, they are just waiting to be reaped
+		std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+		std::string line;
+		if (!std::getline(stat, line)) return false;
+		const size_t end = line.rfind(')');
+		return end != std::string::npos && end + 2 < line.size() && line[end + 2] != 'Z' && line[end + 2] != 'X';
+#endif
+	}
+protected:
+	/// <summary> Reads through a pointer path, combining the validation and the value read into one batch. </summary>
+	/// <param name="path"> Pointer path to read through </param>
+	/// <param name="buffer"> Buffer to read into </param>
+	/// <param name="size"> Number of bytes to read </param>
+	/// <returns> True on success </returns>
+	const bool ReadMemoryPath(PointerPath& path, void* buffer, const size_t size) const
+	{
+		if (!path.resolved && !Resolve(path)) return false;
+		if (path.offsets.empty()) return ReadMemory(path.address, buffer, size);
+
+		if (path.accesses++ < path.epoch)
+		{
+			//Trusted access, a failed read may mean that the chain has moved
+			if (ReadMemory(path.address, buffer, size)) return true;
+		}
+		else
+		{
+			path.accesses = 0;
+			uint64_t pointer;
+			ReadRequest requests[2] = { { path.slot, sizeof(pointer), &pointer }, { path.address, size, buffer } };
+			ReadMemoryBatch(requests, 2, 0);
+			if (requests[0].success && requests[1].success && pointer == path.pointer) return true;
+		}
+		return Resolve(path) && ReadMemory(path.address, buffer, size);
+	}
+
+	/// <summary> Follows a multi-level pointer chain. </summary>
+	/// <param name="address"> Base address, replaced by the final address </param>
+	/// <param name="pointers"> List of multi-level pointers </param>
+	/// <returns> True on success </returns>
+	template <typename C>
+	const bool ResolvePointers(uint64_t& address, const C& pointers) const
+	{
+		if (pointers.size() == 0) return true;
+
+		//Read start address
+		if (!ReadMemory(address, &address, sizeof(address))) return false;
+
+		//Loop through the pointers
+		for (auto it = pointers.begin(); it != std::prev(pointers.end()); it++)
+		{
+			address += *it;
+			if (!ReadMemory(address, &address, sizeof(address))) return false;
+		}
+
+		//Apply the last offset
+		address += *std::prev(pointers.end());
+		return true;
+	}
+
+	/// <summary> Builds the module index on first use and checks it for changes when the check interval elapsed, moduleMutex has to be locked. </summary>
+	inline void CheckModules() const
+	{
+		if (!modulesLoaded || std::chrono::steady_clock::now() - moduleCheck >= moduleCheckInterval) UpdateModules();
+	}
+
+	/// <summary> Looks up a module by name, moduleMutex has to be locked. </summary>
+	const ModuleInfo* LookupModule(const std::string& module) const
+	{
+		CheckModules();
+		const auto it = moduleIndex.find(ToLower(module));
+		return it == moduleIndex.end() ? nullptr : &it->second;
+	}
+
+	/// <summary> FNV-1a hash used for module list signatures. </summary>
+	static const uint64_t Hash(const void* data, const size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		for (size_t i = 0; i < size; i++) hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	static std::string ToLower(std::string value)
+	{
+		std::transform(value.begin(), value.end(), value.begin(), [](const char& c) { return (char)std::tolower((unsigned char)c); });
+		return value;
+	}
+
+	/// <summary> Case insensitive comparision of two names. </summary>
+	static const bool EqualsIgnoreCase(const std::string& a, const std::string& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const char& a, const char& b) { return std::tolower(a) == std::tolower(b);  });
+	}
+
+#ifndef _WIN32
+	/// <summary> Strips the directory part of a path. </summary>
+	static std::string BaseName(const std::string& path)
+	{
+		const size_t pos = path.find_last_of('/');
+		return pos == std::string::npos ? path : path.substr(pos + 1);
+	}
+
+	/// <summary> Opens /proc/pid/mem for the fallback path, once even if several threads fall back together. </summary>
+	/// <returns> True if the file is open </returns>
+	const bool OpenMemFile() const
+	{
+		if (memFd != -1) return true;
+		std::lock_guard<std::mutex> lock(memMutex);
+		int fd = memFd;
+		if (fd == -1 && pid != 0) fd = open(("/proc/" + std::to_string(pid) + "/mem").c_str(), O_RDWR | O_CLOEXEC);
+		if (fd == -1 && pid != 0) fd = open(("/proc/" + std::to_string(pid) + "/mem").c_str(), O_RDONLY | O_CLOEXEC);
+		memFd = fd;
+		return fd != -1;
 	}
+#endif
 };
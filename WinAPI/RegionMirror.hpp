@@ -0,0 +1,193 @@
+/*
+Licensed under the MIT license
+Copyright (c) 2019 Nandor Szalma
+Github: https://github.com/nandee95/My_CPP_Classes
+
+Permission is hereby  granted, free of charge, to any  person obtaining a copy
+of this software and associated  documentation files (the "Software"), to deal
+in the Software  without restriction, including without  limitation the rights
+to  use, copy,  modify, merge,  publish, distribute,  sublicense, and/or  sell
+copies  of  the Software,  and  to  permit persons  to  whom  the Software  is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE  IS PROVIDED "AS  IS", WITHOUT WARRANTY  OF ANY KIND,  EXPRESS OR
+IMPLIED,  INCLUDING BUT  NOT  LIMITED TO  THE  WARRANTIES OF  MERCHANTABILITY,
+FITNESS FOR  A PARTICULAR PURPOSE AND  NONINFRINGEMENT. IN NO EVENT  SHALL THE
+AUTHORS  OR COPYRIGHT  HOLDERS  BE  LIABLE FOR  ANY  CLAIM,  DAMAGES OR  OTHER
+LIABILITY, WHETHER IN AN ACTION OF  CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE  OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "ProcessMemory.hpp"
+
+/// <summary> Local copy of a memory range of another process, refreshed with a single read. </summary>
+class RegionMirror
+{
+public:
+	static const size_t PageSize = 4096;
+	typedef std::chrono::steady_clock Clock;
+protected:
+	const ProcessMemory& process;
+	uint64_t base = 0; //Remote address of the first mirrored page
+	uint64_t address = 0; //Requested remote address
+	size_t size = 0; //Requested size
+	size_t pages = 0; //Number of mirrored pages
+	uint8_t* current = nullptr; //Page aligned copy of the last refresh
+	uint8_t* previous = nullptr; //Page aligned copy of the refresh before
+	std::vector<uint8_t> changed; //Page changed during the last refresh
+	std::vector<uint8_t> readable; //Page could be read during the last refresh
+	size_t changedCount = 0;
+	bool refreshed = false;
+	Clock::duration interval;
+	Clock::time_point lastRefresh;
+public:
+	/// <summary> Creates a mirror of the given range, no memory is read until the first refresh </summary>
+	/// <param name="process"> Process to read from </param>
+	/// <param name="address"> Remote address of the range </param>
+	/// <param name="size"> Size of the range in bytes </param>
+	/// <param name="interval"> Time between refreshes done by Update (Optional) </param>
+	RegionMirror(const ProcessMemory& process, const uint64_t address, const size_t size, const Clock::duration interval = Clock::duration::zero())
+		: process(process), address(address), size(size), interval(interval)
+	{
+		base = address & ~(uint64_t)(PageSize - 1);
+		pages = (size_t)((address + size - base + PageSize - 1) / PageSize);
+		current = static_cast<uint8_t*>(operator new(pages * PageSize, std::align_val_t(PageSize)));
+		previous = static_cast<uint8_t*>(operator new(pages * PageSize, std::align_val_t(PageSize)));
+		changed.resize(pages, 0);
+		readable.resize(pages, 0);
+	}
+
+	RegionMirror(const RegionMirror&) = delete;
+	RegionMirror& operator = (const RegionMirror&) = delete;
+
+	~RegionMirror()
+	{
+		operator delete(current, std::align_val_t(PageSize));
+		operator delete(previous, std::align_val_t(PageSize));
+	}
+
+	/// <summary> Copies the remote range and marks the pages which changed since the last refresh </summary>
+	/// <returns> True if every page could be read </returns>
+	const bool Refresh()
+	{
+		std::swap(current, previous);
+		lastRefresh = Clock::now();
+
+		//One read for the whole range, page by page only if some of it isn't readable
+		bool result = process.ReadMemory(base, current, pages * PageSize);
+		if (result) std::fill(readable.begin(), readable.end(), 1);
+		else for (size_t i = 0; i < pages; i++)
+		{
+			readable[i] = process.ReadMemory(base + i * PageSize, current + i * PageSize, PageSize);
+			if (!readable[i]) memset(current + i * PageSize, 0, PageSize);
+		}
+
+		//Compare against the previous copy
+		changedCount = 0;
+		for (size_t i = 0; i < pages; i++)
+		{
+			changed[i] = !refreshed || memcmp(current + i * PageSize, previous + i * PageSize, PageSize) != 0;
+			changedCount += changed[i];
+			result &= readable[i] != 0;
+		}
+		refreshed = true;
+		return result;
+	}
+
+	/// <summary> Refreshes the mirror if the refresh interval has elapsed </summary>
+	/// <returns> True if a refresh happened </returns>
+	const bool Update()
+	{
+		if (refreshed && Clock::now() - lastRefresh < interval) return false;
+		Refresh();
+		return true;
+	}
+
+	/// <summary> Reads a value from the mirrored copy. </summary>
+	/// <param name="result"> Variable to read into </param>
+	/// <param name="remote"> Remote address of the value </param>
+	/// <returns> True if the value is inside the range and was readable </returns>
+	template <typename T>
+	inline const bool ReadMemoryValue(T& result, const uint64_t remote) const
+	{
+		return ReadMemoryArray(&result, sizeof(result), remote);
+	}
+
+	/// <summary> Reads an array from the mirrored copy. </summary>
+	/// <param name="result"> Array to read into </param>
+	/// <param name="len"> Number of bytes to read </param>
+	/// <param name="remote"> Remote address of the array </param>
+	/// <returns> True if the array is inside the range and was readable </returns>
+	template <typename T>
+	inline const bool ReadMemoryArray(T* result, const size_t len, const uint64_t remote) const
+	{
+		if (!refreshed || remote < base || remote + len > base + pages * PageSize) return false;
+		const size_t offset = (size_t)(remote - base);
+		for (size_t i = offset / PageSize; i * PageSize < offset + len; i++)
+			if (!readable[i]) return false;
+		memcpy(result, current + offset, len);
+		return true;
+	}
+
+	/// <summary> Returns true if any page overlapping the range changed during the last refresh </summary>
+	/// <param name="remote"> Remote address of the range </param>
+	/// <param name="len"> Size of the range in bytes </param>
+	const bool HasChanged(const uint64_t remote, const size_t len) const
+	{
+		if (len == 0 || pages == 0) return false;
+		if (remote + len <= base || remote >= base + pages * PageSize) return false;
+		const size_t first = remote < base ? 0 : (size_t)(remote - base) / PageSize;
+		const size_t last = std::min(pages - 1, (size_t)(remote + len - 1 - base) / PageSize);
+		for (size_t i = first; i <= last; i++)
+			if (changed[i]) return true;
+		return false;
+	}
+
+	/// <summary> Returns true if the page changed during the last refresh </summary>
+	inline const bool IsPageChanged(const size_t page) const noexcept
+	{
+		return changed[page] != 0;
+	}
+
+	/// <summary> Returns the number of pages which changed during the last refresh </summary>
+	inline const size_t GetChangedPageCount() const noexcept
+	{
+		return changedCount;
+	}
+
+	inline const size_t GetPageCount() const noexcept
+	{
+		return pages;
+	}
+
+	/// <summary> Returns the local copy of the requested range </summary>
+	inline const uint8_t* GetData() const noexcept
+	{
+		return current + (address - base);
+	}
+
+	inline const uint64_t GetAddress() const noexcept
+	{
+		return address;
+	}
+
+	inline const size_t GetSize() const noexcept
+	{
+		return size;
+	}
+
+	inline void SetInterval(const Clock::duration value) noexcept
+	{
+		interval = value;
+	}
+};